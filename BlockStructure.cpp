@@ -26,6 +26,7 @@
 #include "Matrix.h"
 #include "Vector.h"
 #include "BlockStructure.h"
+#include "LinComb.h"
 
 using namespace doci2DM;
 
@@ -106,7 +107,8 @@ const BlockType &BlockStructure<BlockType>::operator[](int block) const
 
 
 /**
- * overload the equality operator: Make sure the blocks in both matrices have been allocated to the same dimensions and have the same degeneracy!
+ * overload the equality operator: Blocks that already have the right dimension are
+ * copied in place, the others are (re)allocated.
  * @param blockmat_copy The matrix you want to be copied into this
  */
    template<class BlockType>
@@ -116,7 +118,12 @@ BlockStructure<BlockType> &BlockStructure<BlockType>::operator=(const BlockStruc
 
 #pragma omp parallel for
    for(int i=0;i<blocks.size();i++)
-      blocks[i].reset(new BlockType(blockmat_copy[i]));
+      if(blocks[i] && blocks[i]->gn() == blockmat_copy[i].gn())
+         *blocks[i] = blockmat_copy[i];
+      else
+         blocks[i].reset(new BlockType(blockmat_copy[i]));
+
+   degen = blockmat_copy.degen;
 
    return *this;
 }
@@ -414,6 +421,17 @@ void BlockStructure<BlockType>::sep_pm(BlockStructure<BlockType> &pos, BlockStru
 }
 
 
+/**
+ * Add the memory of all the blocks to the segment list
+ * @param seg the list to add to
+ */
+template<class BlockType>
+void BlockStructure<BlockType>::segments(Segments &seg) const
+{
+   for(int i = 0;i < blocks.size();++i)
+      blocks[i]->segments(seg);
+}
+
 namespace doci2DM
 {
    template<class MyBlockType>
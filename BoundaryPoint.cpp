@@ -25,7 +25,6 @@
 #include <cassert>
 #include <iomanip>
 #include <chrono>
-#include <functional>
 #include <signal.h>
 #include "BoundaryPoint.h"
 #include "Hamiltonian.h"
@@ -33,6 +32,21 @@
 
 #define BP_AVG_ITERS_START 500000
 
+// rotate() leaves the start point alone for larger angles
+#define BP_MAX_ROTATE_ANGLE (M_PI/8)
+
+// the number of scratch TPM, SUP and PHM objects and orbital arrays used in Run()
+#define BP_WS_TPM 8
+#define BP_WS_SUP 4
+#define BP_WS_PHM 1
+#define BP_WS_ORB 2
+
+// the objects Run() used to construct itself: once per call (ham_copy, V, W, u_0, hulp) and in
+// every dual iteration (B, b, v, the help TPM of both collaps calls and r and Hb of InverseS),
+// not counting the two temporaries of every TPM::S in the conjugate gradient of InverseS
+#define BP_ALLOC_PER_RUN 5
+#define BP_ALLOC_PER_DUAL 7
+
 // if set, the signal has been given to stop the calculation and write current step to file
 extern sig_atomic_t stopping;
 
@@ -56,6 +70,8 @@ BoundaryPoint::BoundaryPoint(const CheMPS2::Hamiltonian &hamin)
 
    lineq.reset(new Lineq(L,N));
 
+   ws.reset(new Workspace(L,N,BP_WS_TPM,BP_WS_SUP,BP_WS_PHM,BP_WS_ORB));
+
    BuildHam(hamin);
 
    // some default values
@@ -67,6 +83,8 @@ BoundaryPoint::BoundaryPoint(const CheMPS2::Hamiltonian &hamin)
    mazzy = 1.0;
 
    max_iter = 5;
+   max_primal_iter = 0;
+   max_rotate_angle = BP_MAX_ROTATE_ANGLE;
 
    avg_iters = BP_AVG_ITERS_START; // first step we don't really limited anything
    iters = 0;
@@ -96,6 +114,8 @@ BoundaryPoint::BoundaryPoint(const TPM &hamin)
 
    lineq.reset(new Lineq(L,N));
 
+   ws.reset(new Workspace(L,N,BP_WS_TPM,BP_WS_SUP,BP_WS_PHM,BP_WS_ORB));
+
    BuildHam(hamin);
 
    // some default values
@@ -107,6 +127,8 @@ BoundaryPoint::BoundaryPoint(const TPM &hamin)
    mazzy = 1.0;
 
    max_iter = 5;
+   max_primal_iter = 0;
+   max_rotate_angle = BP_MAX_ROTATE_ANGLE;
 
    avg_iters = 1000000; // first step we don't really limited anything
    iters = 0;
@@ -132,6 +154,8 @@ BoundaryPoint::BoundaryPoint(const BoundaryPoint &orig)
 
    lineq.reset(new Lineq(*orig.lineq));
 
+   ws.reset(new Workspace(*orig.ws));
+
    useprevresult = orig.useprevresult;
 
    sigma = orig.sigma;;
@@ -142,6 +166,8 @@ BoundaryPoint::BoundaryPoint(const BoundaryPoint &orig)
    mazzy = orig.mazzy;
 
    max_iter = orig.max_iter;
+   max_primal_iter = orig.max_primal_iter;
+   max_rotate_angle = orig.max_rotate_angle;
 
    energy = orig.energy;
 
@@ -169,6 +195,9 @@ BoundaryPoint& BoundaryPoint::operator=(const BoundaryPoint &orig)
 
    (*lineq) = *orig.lineq;
 
+   if(ws->gL() != L || ws->gN() != N)
+      ws.reset(new Workspace(L,N,BP_WS_TPM,BP_WS_SUP,BP_WS_PHM,BP_WS_ORB));
+
    useprevresult = orig.useprevresult;
 
    sigma = orig.sigma;;
@@ -179,6 +208,8 @@ BoundaryPoint& BoundaryPoint::operator=(const BoundaryPoint &orig)
    mazzy = orig.mazzy;
 
    max_iter = orig.max_iter;
+   max_primal_iter = orig.max_primal_iter;
+   max_rotate_angle = orig.max_rotate_angle;
 
    energy = orig.energy;
 
@@ -212,10 +243,7 @@ BoundaryPoint* BoundaryPoint::Move()
  */
 void BoundaryPoint::BuildHam(const CheMPS2::Hamiltonian &hamin)
 {
-   std::function<double(int,int)> getT = [&hamin] (int a, int b) -> double { return hamin.getTmat(a,b); };
-   std::function<double(int,int,int,int)> getV = [&hamin] (int a, int b, int c, int d) -> double { return hamin.getVmat(a,b,c,d); };
-
-   ham->ham(getT, getV);
+   ham->ham(DociIntegrals(hamin));
 }
 
 /**
@@ -233,7 +261,11 @@ void BoundaryPoint::BuildHam(const TPM &hamin)
  */
 unsigned int BoundaryPoint::Run()
 {
-   TPM ham_copy(*ham);
+   // all temporary objects come from the workspace
+   const unsigned long handed_out = ws->gHandedOut();
+
+   TPM &ham_copy = ws->getTPM(0);
+   ham_copy = *ham;
 
    //only traceless hamiltonian needed in program.
    ham_copy.Proj_E(*lineq);
@@ -245,15 +277,15 @@ unsigned int BoundaryPoint::Run()
    }
 
    //Lagrange multiplier
-   SUP V(L,N);
+   SUP &V = ws->getSUP(0);
 
    //just dubya
-   SUP W(L,N);
+   SUP &W = ws->getSUP(1);
 
-   SUP u_0(L,N);
+   SUP &u_0 = ws->getSUP(2);
 
    //little help
-   TPM hulp(L,N);
+   TPM &hulp = ws->getTPM(1);
 
    u_0.init_S(*lineq);
 
@@ -297,28 +329,24 @@ unsigned int BoundaryPoint::Run()
          ++iter_dual;
 
          //solve system
-         SUP B(*Z);
-
-         B -= u_0;
+         SUP &B = ws->getSUP(3);
 
-         B.daxpy(1.0/sigma,*X);
+         B = *Z - u_0 + (1.0/sigma) * (*X);
 
-         TPM b(L,N);
+         TPM &b = ws->getTPM(2);
 
-         b.collaps(B, *lineq);
+         b.collaps(B, *lineq, ws->getTPM(4), ws->getOrbital(0), ws->getOrbital(1));
 
          b.daxpy(-1.0/sigma,ham_copy);
 
-         hulp.InverseS(b, *lineq);
+         hulp.InverseS(b, *lineq, ws->getTPM(5), ws->getTPM(6), ws->getPHM(0), ws->getTPM(7), ws->getOrbital(0), ws->getOrbital(1));
 
-         hulp.Proj_E(*lineq);
+         hulp.Proj_E(*lineq, ws->getOrbital(0), ws->getOrbital(1));
 
          //construct W
          W.fill(hulp);
 
-         W += u_0;
-
-         W.daxpy(-mazzy/sigma,*X);
+         W += u_0 - (mazzy/sigma) * (*X);
 
          //update Z and V with eigenvalue decomposition:
          W.sep_pm(*Z,V);
@@ -326,9 +354,9 @@ unsigned int BoundaryPoint::Run()
          V.dscal(-sigma);
 
          //check infeasibility of the primal problem:
-         TPM v(L,N);
+         TPM &v = ws->getTPM(3);
 
-         v.collaps(V, *lineq);
+         v.collaps(V, *lineq, ws->getTPM(4), ws->getOrbital(0), ws->getOrbital(1));
 
          v -= ham_copy;
 
@@ -341,9 +369,7 @@ unsigned int BoundaryPoint::Run()
       //check dual feasibility (W is a helping variable now)
       W.fill(hulp);
 
-      W += u_0;
-
-      W -= *Z;
+      W += u_0 - *Z;
 
       P_conv = sqrt(W.ddot(W));
 
@@ -373,6 +399,9 @@ unsigned int BoundaryPoint::Run()
          sigma *= 1.01;
       else
          sigma /= 1.01;
+
+      if(max_primal_iter && iter_primal >= max_primal_iter)
+         break;
    }
 
    auto end = std::chrono::high_resolution_clock::now();
@@ -397,6 +426,8 @@ unsigned int BoundaryPoint::Run()
    out << "Runtime: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
    out << "Primal iters: " << iter_primal << std::endl;
    out << "avg primal iters: " << avg_iters << std::endl;
+   out << "Allocations avoided: " << BP_ALLOC_PER_RUN + BP_ALLOC_PER_DUAL * (unsigned long) tot_iter << std::endl;
+   out << "Scratch objects handed out: " << ws->gHandedOut() - handed_out << std::endl;
 
    out << std::endl;
    out << "total nr of iterations = " << tot_iter << std::endl;
@@ -440,6 +471,25 @@ void BoundaryPoint::set_max_iter(unsigned int iters)
     this->max_iter = iters;
 }
 
+/**
+ * Stop Run() after this many primal iterations, even if it's not converged
+ * @param iters the maximum number of primal iterations, 0 means no limit
+ */
+void BoundaryPoint::set_max_primal_iter(unsigned int iters)
+{
+    this->max_primal_iter = iters;
+}
+
+/**
+ * rotate() only rotates the start point for angles up to this, for larger
+ * angles the unrotated solution is the better start
+ * @param angle the largest |angle| to rotate over, M_PI/2 or more to always rotate
+ */
+void BoundaryPoint::set_max_rotate_angle(double angle)
+{
+    this->max_rotate_angle = angle;
+}
+
 doci2DM::SUP& BoundaryPoint::getX() const
 {
     return (*X);
@@ -471,6 +521,24 @@ void BoundaryPoint::set_use_prev_result(bool new_val)
    useprevresult = new_val;
 }
 
+/**
+ * Rotate the current primal and dual solution with a jacobi rotation between
+ * orbitals k and l over angle, so they are a good start point (see set_use_prev_result)
+ * for the hamiltonian after the same rotation.
+ * @param k the first orbital
+ * @param l the second orbital
+ * @param angle the angle to rotate over
+ */
+void BoundaryPoint::rotate(int k, int l, double angle)
+{
+   // for large angles the projection in PHM::rotate is a poor start, keep the unrotated one
+   if(fabs(angle) > max_rotate_angle)
+      return;
+
+   X->rotate(k,l,angle);
+   Z->rotate(k,l,angle);
+}
+
 double BoundaryPoint::get_tol_PD() const
 {
    return tol_PD;
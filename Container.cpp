@@ -24,6 +24,7 @@
 #include <assert.h>
 
 #include "Container.h"
+#include "LinComb.h"
 
 using namespace doci2DM;
 
@@ -305,6 +306,16 @@ void Container::sep_pm(Container &pos, Container &neg)
    vector->sep_pm(*pos.vector, *neg.vector);
 }
 
+/**
+ * Add the memory of this Container to the segment list
+ * @param seg the list to add to
+ */
+void Container::segments(Segments &seg) const
+{
+   matrix->segments(seg);
+   vector->segments(seg);
+}
+
 namespace doci2DM
 {
    std::ostream &operator<<(std::ostream &output,const doci2DM::Container &container)
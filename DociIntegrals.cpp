@@ -0,0 +1,102 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+
+#include <cassert>
+#include <stdexcept>
+
+#include "DociIntegrals.h"
+#include "Hamiltonian.h"
+
+using doci2DM::DociIntegrals;
+
+/**
+ * Create an empty digest (everything zero), fill it with the non-const accessors.
+ * There are no k/l slices available in this case.
+ * @param L the nr of spatial orbitals
+ */
+DociIntegrals::DociIntegrals(int L)
+{
+   this->L = L;
+
+   oei.resize(L*L, 0);
+   aabb.resize(L*L, 0);
+   abab.resize(L*L, 0);
+   abba.resize(L*L, 0);
+
+   source = nullptr;
+}
+
+/**
+ * Extract the DOCI integrals from a Hamiltonian. Only a pointer to ham is kept for
+ * the k/l slices: ham should outlive this object (or at least every call of get_slice).
+ * @param ham the integrals to use
+ */
+DociIntegrals::DociIntegrals(const CheMPS2::Hamiltonian &ham): DociIntegrals(ham.getL())
+{
+   for(int a=0;a<L;a++)
+      for(int b=0;b<L;b++)
+      {
+         oei[a*L+b] = ham.getTmat(a,b);
+         aabb[a*L+b] = ham.getVmat(a,a,b,b);
+         abab[a*L+b] = ham.getVmat(a,b,a,b);
+         abba[a*L+b] = ham.getVmat(a,b,b,a);
+      }
+
+   source = &ham;
+}
+
+int DociIntegrals::gL() const
+{
+   return L;
+}
+
+/**
+ * @return true if the k/l slices are available
+ */
+bool DociIntegrals::has_slices() const
+{
+   return source != nullptr;
+}
+
+/**
+ * The three slices needed for a jacobi rotation between orbitals k and l
+ * @param k the first orbital
+ * @param l the second orbital
+ * @param slice array of size 3L: V(k,l,a,a), V(k,a,l,a) and V(k,a,a,l) for all a
+ * @throw std::logic_error when there is no source Hamiltonian (see has_slices)
+ */
+void DociIntegrals::get_slice(int k, int l, double *slice) const
+{
+   if(!source)
+      throw std::logic_error("DociIntegrals::get_slice: no k/l slices available without a source Hamiltonian");
+
+   for(int a=0;a<L;a++)
+   {
+      slice[a] = source->getVmat(k,l,a,a);
+      slice[L+a] = source->getVmat(k,a,l,a);
+      slice[2*L+a] = source->getVmat(k,a,a,l);
+   }
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
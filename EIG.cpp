@@ -84,11 +84,13 @@ EIG::EIG(SUP &sup): BlockVector(sup.gnr())
 #endif
 
 #ifdef __G_CON
-   for(int i=0;i<sup.getG().gnr();i++)
-   {
-      setDim(tel, sup.getG().gdim(i), sup.getG().gdeg(i));
-      (*this)[tel++].diagonalize(sup.getG()[i]);
-   }
+   // the LxL block
+   setDim(tel, sup.gL(), 1);
+   (*this)[tel++].diagonalize(sup.getG().getLxL());
+
+   // all the 2x2 blocks in one go
+   setDim(tel, 2*sup.getG().gn2x2(), 1);
+   sup.getG().eigenvalues_2x2((*this)[tel++]);
 #endif
 }
 
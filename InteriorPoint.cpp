@@ -0,0 +1,599 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <signal.h>
+#include "InteriorPoint.h"
+#include "Hamiltonian.h"
+#include "lapack.h"
+
+// if set, the signal has been given to stop the calculation and write current step to file
+extern sig_atomic_t stopping;
+
+using CheMPS2::Hamiltonian;
+using doci2DM::InteriorPoint;
+
+InteriorPoint::InteriorPoint(const CheMPS2::Hamiltonian &hamin)
+{
+   N = hamin.getNe();
+   L = hamin.getL();
+   nuclrep = hamin.getEconst();
+
+   ham.reset(new TPM(L,N));
+
+   rdm.reset(new TPM(L,N));
+
+   Z.reset(new SUP(L,N));
+
+   lineq.reset(new Lineq(L,N));
+
+   BuildHam(hamin);
+
+   // some default values
+   tolerance = 1.0e-8;
+   max_iter = 100;
+   gap = 1;
+   D_conv = 1;
+   energy = 0;
+}
+
+InteriorPoint::InteriorPoint(const TPM &hamin)
+{
+   N = hamin.gN();
+   L = hamin.gL();
+   nuclrep = 0;
+
+   ham.reset(new TPM(hamin));
+
+   rdm.reset(new TPM(L,N));
+
+   Z.reset(new SUP(L,N));
+
+   lineq.reset(new Lineq(L,N));
+
+   BuildHam(hamin);
+
+   // some default values
+   tolerance = 1.0e-8;
+   max_iter = 100;
+   gap = 1;
+   D_conv = 1;
+   energy = 0;
+}
+
+InteriorPoint::InteriorPoint(const InteriorPoint &orig)
+{
+   N = orig.N;
+   L = orig.L;
+   nuclrep = orig.nuclrep;
+
+   ham.reset(new TPM(*orig.ham));
+
+   rdm.reset(new TPM(*orig.rdm));
+
+   Z.reset(new SUP(*orig.Z));
+
+   lineq.reset(new Lineq(*orig.lineq));
+
+   tolerance = orig.tolerance;
+   max_iter = orig.max_iter;
+   gap = orig.gap;
+   D_conv = orig.D_conv;
+   energy = orig.energy;
+   norm_ham = orig.norm_ham;
+}
+
+InteriorPoint& InteriorPoint::operator=(const InteriorPoint &orig)
+{
+   N = orig.N;
+   L = orig.L;
+   nuclrep = orig.nuclrep;
+
+   (*ham) = *orig.ham;
+
+   (*rdm) = *orig.rdm;
+
+   (*Z) = *orig.Z;
+
+   (*lineq) = *orig.lineq;
+
+   tolerance = orig.tolerance;
+   max_iter = orig.max_iter;
+   gap = orig.gap;
+   D_conv = orig.D_conv;
+   energy = orig.energy;
+   norm_ham = orig.norm_ham;
+
+   return *this;
+}
+
+InteriorPoint* InteriorPoint::Clone() const
+{
+   return new InteriorPoint(*this);
+}
+
+InteriorPoint* InteriorPoint::Move()
+{
+   return new InteriorPoint(std::move(*this));
+}
+
+/**
+ * Build the new reduced hamiltonian based on the integrals
+ * in ham
+ * @param hamin the integrals to use
+ */
+void InteriorPoint::BuildHam(const CheMPS2::Hamiltonian &hamin)
+{
+   ham->ham(DociIntegrals(hamin));
+
+   norm_ham = std::sqrt(ham->ddot(*ham));
+   (*ham) /= norm_ham;
+}
+
+/**
+ * Copy the reduced hamiltonian from a TPM object
+ * @param hamin the TPM object to use
+ */
+void InteriorPoint::BuildHam(const TPM &hamin)
+{
+   (*ham) = hamin;
+
+   norm_ham = std::sqrt(ham->ddot(*ham));
+   (*ham) /= norm_ham;
+}
+
+/**
+ * Do an actual calculation: calculate the energy of the
+ * reduced hamiltonian in ham. Every iteration does one factorization
+ * of the Schur complement and two solves with it: the affine (predictor)
+ * step and the centered, second order corrected (corrector) step.
+ * @return the number of iterations
+ * @throw std::runtime_error when the Schur complement is larger than IP_MAX_SCHUR_MB
+ */
+unsigned int InteriorPoint::Run()
+{
+   const std::size_t dim = L*L;
+
+   if(dim*dim*sizeof(double) > IP_MAX_SCHUR_MB*1024UL*1024UL)
+   {
+      std::stringstream msg;
+      msg << "The Schur complement for L=" << L << " needs " << dim*dim*sizeof(double)/(1024*1024) << " MB, more than the limit of " << IP_MAX_SCHUR_MB << " MB, use another method.";
+      throw std::runtime_error(msg.str());
+   }
+
+   std::ostream* fp = &std::cout;
+   std::ofstream fout;
+   if(!outfile.empty())
+   {
+      fout.open(outfile, std::ios::out | std::ios::app);
+      fp = &fout;
+   }
+   std::ostream &out = *fp;
+   out.precision(10);
+
+   auto start = std::chrono::high_resolution_clock::now();
+
+   // start on the central path: X Z = 1
+   rdm->init(*lineq);
+
+   SUP X(L,N);
+   X.fill(*rdm);
+
+   (*Z) = X;
+   Z->invert();
+
+   // the barrier parameter of the cone: Tr (X^-1 X)
+   const double nu = Z->ddot(X);
+
+   SUP unit(L,N);
+   unit.unit();
+
+   // the Jordan product (AB + BA)/2 of two symmetric SUP's
+   auto jordan = [&unit](const SUP &A, const SUP &B, SUP &res)
+   {
+      SUP sum(A);
+      sum += B;
+
+      SUP sq(A.gL(), A.gN());
+
+      res.L_map(sum, unit);
+      sq.L_map(A, unit);
+      res -= sq;
+      sq.L_map(B, unit);
+      res -= sq;
+
+      res.dscal(0.5);
+   };
+
+   TPM ham_E(*ham);
+   ham_E.Proj_E(*lineq);
+
+   SUP Xinv(L,N), X_mh(L,N), Z_mh(L,N), Winv(L,N), W_h(L,N), W_mh(L,N), V_mh(L,N);
+   SUP R(L,N), dX(L,N), dZ(L,N), hulp(L,N), hulp2(L,N);
+   TPM D_res(L,N), dG(L,N);
+
+   // fraction of the step to the boundary
+   double gamma = 0.9;
+
+   unsigned int iter = 0;
+
+   while(iter < max_iter)
+   {
+      // dual residual: Proj_E (H - L^dagger(Z))
+      D_res.collaps(*Z, *lineq);
+      D_res *= -1.0;
+      D_res += ham_E;
+
+      const double pobj = ham->ddot(*rdm);
+      const double XZ = X.ddot(*Z);
+      const double mu = XZ / nu;
+
+      gap = XZ / (1.0 + std::fabs(pobj));
+      D_conv = std::sqrt(D_res.ddot(D_res));
+
+      if(do_output)
+         out << iter << "\t" << std::setw(16) << pobj*norm_ham + nuclrep << "\t" << std::setw(16) << gap << "\t" << std::setw(16) << D_conv << "\t" << std::setw(16) << mu << std::endl;
+
+      if( (gap < tolerance && D_conv < tolerance) || stopping)
+         break;
+
+      ++iter;
+
+      Xinv = X;
+      Xinv.invert();
+
+      X_mh = X;
+      X_mh.sqrt(-1);
+
+      Z_mh = *Z;
+      Z_mh.sqrt(-1);
+
+      // the Nesterov-Todd scaling: W^-1 = X^-1/2 (X^1/2 Z X^1/2)^1/2 X^-1/2
+      hulp = X;
+      hulp.sqrt(1);
+      hulp2.L_map(hulp, *Z);
+      hulp2.sqrt(1);
+      Winv.L_map(X_mh, hulp2);
+
+      int info = factorize_schur(Winv);
+
+      if(info)
+      {
+         out << "Cholesky factorization of the Schur complement failed: " << info << std::endl;
+         break;
+      }
+
+      // predictor: sigma = 0
+      R = *Z;
+      R *= -1.0;
+
+      solve_schur(Winv, R, D_res, dG, dX, dZ);
+
+      const double a_p = std::min(1.0, max_step(X_mh, dX));
+      const double a_d = std::min(1.0, max_step(Z_mh, dZ));
+
+      hulp = X;
+      hulp.daxpy(a_p, dX);
+      hulp2 = *Z;
+      hulp2.daxpy(a_d, dZ);
+
+      const double mu_aff = hulp.ddot(hulp2) / nu;
+
+      double sigma = std::pow(mu_aff/mu, 3);
+      if(sigma > 1)
+         sigma = 1;
+
+      // corrector: the second order term is formed in the scaled space,
+      // V = W^1/2 Z W^1/2 = W^-1/2 X W^-1/2, dx = W^-1/2 dX W^-1/2 and dz = W^1/2 dZ W^1/2:
+      // dX + W dZ W = sigma mu Z^-1 - X - W^1/2 V^-1/2 (dx o dz) V^-1/2 W^1/2
+      // (the inverse of the Lyapunov map of V is replaced by V^-1/2 . V^-1/2, exact when they commute)
+      W_h = Winv;
+      W_h.sqrt(-1);
+      W_mh = Winv;
+      W_mh.sqrt(1);
+
+      V_mh.L_map(W_h, *Z);
+      V_mh.sqrt(-1);
+
+      hulp.L_map(W_mh, dX);
+      hulp2.L_map(W_h, dZ);
+      jordan(hulp, hulp2, dX);
+
+      hulp.L_map(V_mh, dX);
+      hulp2.L_map(W_mh, hulp);
+
+      R = Xinv;
+      R *= sigma * mu;
+      R -= *Z;
+      R -= hulp2;
+
+      solve_schur(Winv, R, D_res, dG, dX, dZ);
+
+      const double alpha_p = std::min(1.0, gamma * max_step(X_mh, dX));
+      const double alpha_d = std::min(1.0, gamma * max_step(Z_mh, dZ));
+
+      rdm->daxpy(alpha_p, dG);
+      X.fill(*rdm);
+
+      Z->daxpy(alpha_d, dZ);
+
+      gamma = 0.9 + 0.09 * std::min(alpha_p, alpha_d);
+
+      if(do_output)
+         out << "   " << sigma << "\t" << alpha_p << "\t" << alpha_d << std::endl;
+   }
+
+   auto end = std::chrono::high_resolution_clock::now();
+
+   energy = norm_ham*ham->ddot(*rdm);
+
+   out << std::endl;
+   out << "Energy: " << getFullEnergy() << std::endl;
+   out << "Trace: " << rdm->trace() << std::endl;
+   out << "pd gap: " << gap << std::endl;
+   out << "dual conv: " << D_conv << std::endl;
+   out << "S^2: " << rdm->S_2() << std::endl;
+   out << "Runtime: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
+
+   out << std::endl;
+   out << "total nr of iterations = " << iter << std::endl;
+
+   if(!outfile.empty())
+      fout.close();
+
+   return iter;
+}
+
+/**
+ * The coordinates of a TPM in an orthonormal basis (for TPM::ddot) of the TPM space:
+ * the upper triangle of the LxL block (off diagonal elements times sqrt(2))
+ * followed by the vector (times 2, the square root of its degeneracy).
+ * @param tpm the TPM
+ * @param x array of size L^2 to store the coordinates in
+ */
+void InteriorPoint::pack(const TPM &tpm, double *x) const
+{
+   int idx = 0;
+
+   for(int i=0;i<L;i++)
+   {
+      x[idx++] = tpm(0,i,i);
+
+      for(int j=i+1;j<L;j++)
+         x[idx++] = std::sqrt(2.0) * tpm(0,i,j);
+   }
+
+   for(int i=0;i<tpm.gdimVector(0);i++)
+      x[idx++] = 2.0 * tpm(0,i);
+}
+
+/**
+ * The inverse of pack
+ * @param x array of size L^2 with the coordinates
+ * @param tpm the TPM to store the result in
+ */
+void InteriorPoint::unpack(const double *x, TPM &tpm) const
+{
+   int idx = 0;
+
+   for(int i=0;i<L;i++)
+   {
+      tpm(0,i,i) = x[idx++];
+
+      for(int j=i+1;j<L;j++)
+         tpm(0,i,j) = tpm(0,j,i) = x[idx++] / std::sqrt(2.0);
+   }
+
+   for(int i=0;i<tpm.gdimVector(0);i++)
+      tpm(0,i) = x[idx++] / 2.0;
+}
+
+/**
+ * Assemble the Schur complement Proj_E L^dagger(W^-1 L(.) W^-1) Proj_E
+ * and factorize it. The part orthogonal to the constraints is set to the
+ * identity, so the matrix is positive definite and the solution of a right
+ * hand side that satisfies the (homogeneous) constraints satisfies them too.
+ * The columns are independent and built in parallel.
+ * @param Winv the inverse of the scaling matrix
+ * @return the info of the Cholesky factorization (0 on success)
+ */
+int InteriorPoint::factorize_schur(const SUP &Winv)
+{
+   const std::size_t dim = L*L;
+
+   schur.resize(dim*dim);
+
+#pragma omp parallel
+   {
+      std::vector<double> x(dim, 0);
+      TPM b(L,N);
+      TPM Pb(L,N);
+      TPM Hb(L,N);
+
+#pragma omp for schedule(dynamic)
+      for(std::size_t k=0;k<dim;k++)
+      {
+         x[k] = 1;
+         unpack(x.data(), b);
+         x[k] = 0;
+
+         Pb = b;
+         Pb.Proj_E(*lineq);
+
+         Hb.H(1.0, Pb, Winv, *lineq);
+
+         b -= Pb;
+         Hb += b;
+
+         pack(Hb, &schur[k*dim]);
+      }
+   }
+
+   char uplo = 'L';
+   int n = dim;
+   int info;
+
+   dpotrf_(&uplo, &n, schur.data(), &n, &info);
+
+   return info;
+}
+
+/**
+ * Solve the Newton system with the factorized Schur complement for a given
+ * right hand side of the complementarity equation X + W Z W = ...,
+ * expressed as dZ = R - W^-1 dX W^-1.
+ * @param Winv the inverse of the scaling matrix
+ * @param R the right hand side
+ * @param D_res the dual residual Proj_E (H - L^dagger(Z))
+ * @param dG the step for the rdm
+ * @param dX the step for X: L(dG)
+ * @param dZ the step for Z
+ */
+void InteriorPoint::solve_schur(const SUP &Winv, const SUP &R, const TPM &D_res, TPM &dG, SUP &dX, SUP &dZ) const
+{
+   int dim = L*L;
+
+   TPM rhs(L,N);
+   rhs.collaps(R, *lineq);
+   rhs -= D_res;
+
+   std::vector<double> x(dim);
+   pack(rhs, x.data());
+
+   char uplo = 'L';
+   int nrhs = 1;
+   int info;
+
+   dpotrs_(&uplo, &dim, &nrhs, const_cast<double *>(schur.data()), &dim, x.data(), &dim, &info);
+
+   unpack(x.data(), dG);
+   dG.Proj_E(*lineq);
+
+   dX.fill(dG);
+
+   dZ.L_map(Winv, dX);
+   dZ *= -1.0;
+   dZ += R;
+}
+
+/**
+ * The largest step a so that S + a delta stays positive semidefinite
+ * @param S_mh the inverse square root of S
+ * @param delta the step
+ * @return the maximal step length
+ */
+double InteriorPoint::max_step(const SUP &S_mh, const SUP &delta)
+{
+   SUP hulp(S_mh.gL(), S_mh.gN());
+
+   hulp.L_map(S_mh, delta);
+
+   EIG eigen(hulp);
+
+   double min = eigen.min();
+
+   if(min >= 0)
+      return std::numeric_limits<double>::max();
+
+   return -1.0/min;
+}
+
+/**
+ * @return the full energy (with the nuclear replusion part)
+ */
+double InteriorPoint::getFullEnergy() const
+{
+    return energy + nuclrep;
+}
+
+void InteriorPoint::set_tolerance(double tol)
+{
+    this->tolerance = tol;
+}
+
+void InteriorPoint::set_max_iter(unsigned int iters)
+{
+    this->max_iter = iters;
+}
+
+/**
+ * @return the relative duality gap of the last iteration
+ */
+double InteriorPoint::get_gap() const
+{
+    return gap;
+}
+
+/**
+ * @return the dual infeasibility of the last iteration
+ */
+double InteriorPoint::get_D_conv() const
+{
+    return D_conv;
+}
+
+doci2DM::TPM& InteriorPoint::getRDM() const
+{
+    return (*rdm);
+}
+
+doci2DM::TPM& InteriorPoint::getHam() const
+{
+   return *ham;
+}
+
+doci2DM::SUP& InteriorPoint::getZ() const
+{
+   return *Z;
+}
+
+doci2DM::Lineq& InteriorPoint::getLineq() const
+{
+    return (*lineq);
+}
+
+/**
+ * Give the energy with the current rdm and ham
+ * @return the newly evaluated energy
+ */
+double InteriorPoint::evalEnergy() const
+{
+   return norm_ham*ham->ddot(*rdm) + nuclrep;
+}
+
+/**
+ * Check if last calculation was fully convergenced
+ * @return true if all convergence critera are met, false otherwise
+ */
+bool InteriorPoint::FullyConverged() const
+{
+   return gap < tolerance && D_conv < tolerance;
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
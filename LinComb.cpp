@@ -0,0 +1,110 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#include "LinComb.h"
+
+/**
+ * The kernel for one segment: o = (add ? o : 0) + sum_k alpha[k] * x[k]
+ */
+template<int n>
+static void lincomb_segment(double *o, const double * const *x, const double *alpha, int len, bool add)
+{
+#pragma omp simd
+   for(int i=0;i<len;i++)
+   {
+      double res = add ? o[i] : 0.0;
+
+      for(int k=0;k<n;k++)
+         res += alpha[k] * x[k][i];
+
+      o[i] = res;
+   }
+}
+
+/**
+ * Fallback for linear combinations with many terms
+ */
+static void lincomb_segment(int n, double *o, const double * const *x, const double *alpha, int len, bool add)
+{
+#pragma omp simd
+   for(int i=0;i<len;i++)
+   {
+      double res = add ? o[i] : 0.0;
+
+      for(int k=0;k<n;k++)
+         res += alpha[k] * x[k][i];
+
+      o[i] = res;
+   }
+}
+
+/**
+ * Calculate out = sum_k alpha[k]*in[k] (or out += ... when add is set)
+ * in one pass over all segments. All objects should have the same shape.
+ * The output may be one of the inputs.
+ * @param out the segments of the output object
+ * @param n the number of terms
+ * @param alpha the coefficients of the terms
+ * @param in the segments of each of the terms
+ * @param add add to out instead of overwriting it
+ */
+void doci2DM::lincomb(Segments &out, int n, const double *alpha, const Segments *in, bool add)
+{
+   assert(n <= LINCOMB_MAX_TERMS);
+
+   for(int k=0;k<n;k++)
+   {
+      assert(in[k].nseg == out.nseg);
+
+      for(int s=0;s<out.nseg;s++)
+         assert(in[k].size[s] == out.size[s]);
+   }
+
+   const double *x[LINCOMB_MAX_TERMS];
+
+   for(int s=0;s<out.nseg;s++)
+   {
+      for(int k=0;k<n;k++)
+         x[k] = in[k].ptr[s];
+
+      switch(n)
+      {
+         case 1:
+            lincomb_segment<1>(out.ptr[s], x, alpha, out.size[s], add);
+            break;
+         case 2:
+            lincomb_segment<2>(out.ptr[s], x, alpha, out.size[s], add);
+            break;
+         case 3:
+            lincomb_segment<3>(out.ptr[s], x, alpha, out.size[s], add);
+            break;
+         case 4:
+            lincomb_segment<4>(out.ptr[s], x, alpha, out.size[s], add);
+            break;
+         default:
+            lincomb_segment(n, out.ptr[s], x, alpha, out.size[s], add);
+      }
+   }
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
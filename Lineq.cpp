@@ -22,13 +22,17 @@
  */
 
 #include <assert.h>
+#include <cmath>
 
 #include "include.h"
+#include "lapack.h"
 
 using namespace doci2DM;
 
 /**
- * standard constructor, only norm and DOCI constraints
+ * standard constructor, only norm and DOCI constraints. Filling the constraints
+ * is O(L^2), but orthogonalize() and constr_inverse_S() work with (L+1) constraints
+ * of size 2L and 2L x 2L matrices, so the construction as a whole is O(L^3).
  * @param L nr of levels
  * @param N nr of particles
  * @param partial_trace use constraints for the block and vector seperatly
@@ -38,47 +42,53 @@ Lineq::Lineq(int L,int N, bool partial_trace)
    this->L = L;
    this->N = N;
 
+   // all constraints live in the orbital part of a TPM (see TPM::get_orbital_part):
+   // they are stored as (m,u) with M_aa = m_a and v_ab = u_a + u_b
    if(partial_trace)
    {
-      TPM trace_constr(L,N);
-      trace_constr = 0;
+      E.resize(2*2*L, 0);
+      e.resize(2, 0);
 
-      for(int i=0;i<trace_constr.gdimMatrix(0);i++)
-         trace_constr(0,i,i) = 1;
+      // trace on the block
+      for(int a=0;a<L;a++)
+         E[a] = 1;
 
-      E.push_back(trace_constr);
-      e.push_back(N/2.0);
+      e[0] = N/2.0;
 
-      trace_constr.getMatrix(0) = 0;
-      for(int i=0;i<trace_constr.gdimVector(0);i++)
-         trace_constr(0,i) = 1;
+      // trace on the vector
+      for(int a=0;a<L;a++)
+         E[2*L+L+a] = 0.5;
 
-      E.push_back(std::move(trace_constr));
-      e.push_back(N*(N/2.0-1)); // keep the fourfold degenaracy in mind
+      e[1] = N*(N/2.0-1); // keep the fourfold degenaracy in mind
    } else
    {
-      TPM trace_constr(L,N);
-      trace_constr.unit();
-
       // make room for 1 trace constrains and L DOCI constrains
+      E.resize((1+L)*2*L, 0);
       e.resize(1+L, 0);
 
-      // first trace on Block
-      E.push_back(std::move(trace_constr));
+      // first trace on Block: the unit matrix
+      for(int a=0;a<L;a++)
+      {
+         E[a] = 1;
+         E[L+a] = 0.5;
+      }
+
       e[0] = N*(N-1)/2.0;
 
-      auto doci_constr = trace_constr.DOCI_constrains();
-      E.insert(E.end(), std::make_move_iterator(doci_constr.begin()), std::make_move_iterator(doci_constr.end()));
+      // the DOCI constraints: see TPM::DOCI_constrains
+      for(int a=0;a<L;a++)
+      {
+         double *constr = &E[(1+a)*2*L];
 
-      assert(E.size() == 1+L);
+         constr[a] = -1;
+         // divide by 4 to compensate for the degeneracy
+         constr[L+a] = 1.0/(N/2.0-1)/4.0;
+      }
    }
 
    orthogonalize();//speaks for itself, doesn't it?
 
-   //construct the u^0 SUP matrices
-   constr_u_0();
-
-   orthogonalize_u_0();
+   constr_inverse_S();
 }
 
 /**
@@ -94,7 +104,7 @@ int Lineq::gN() const
  */
 int Lineq::gnr() const
 {
-   return E.size();
+   return e.size();
 }
 
 /**
@@ -106,13 +116,17 @@ int Lineq::gL() const
 }
 
 /**
- * access to the individual constraint TPM's
+ * access to the individual constraint TPM's, constructed on the fly
  * @param i the index
  * @return The E TPM on index i.
  */
-const TPM &Lineq::gE(int i) const
+TPM Lineq::gE(int i) const
 {
-   return E[i];
+   TPM constr(L,N);
+   constr = 0;
+   constr.add_orbital_part(1.0, gE_orb(i));
+
+   return constr;
 }
 
 /**
@@ -126,13 +140,17 @@ double Lineq::ge(int i) const
 }
 
 /**
- * access to the individual orthogonalized constraint TPM's: private function
+ * access to the individual orthogonalized constraint TPM's, constructed on the fly
  * @param i the index
  * @return The E_ortho TPM on index i.
  */
-const TPM &Lineq::gE_ortho(int i) const
+TPM Lineq::gE_ortho(int i) const
 {
-   return E_ortho[i];
+   TPM constr(L,N);
+   constr = 0;
+   constr.add_orbital_part(1.0, gE_ortho_orb(i));
+
+   return constr;
 }
 
 /**
@@ -145,6 +163,49 @@ double Lineq::ge_ortho(int i) const
    return e_ortho[i];
 }
 
+/**
+ * access to a constraint in orbital coordinates (see TPM::get_orbital_part)
+ * @param i the index
+ * @return pointer to the 2L values (m,u) of constraint i
+ */
+const double *Lineq::gE_orb(int i) const
+{
+   return &E[i*2*L];
+}
+
+/**
+ * access to an orthogonalized constraint in orbital coordinates (see TPM::get_orbital_part)
+ * @param i the index
+ * @return pointer to the 2L values (m,u) of orthogonalized constraint i
+ */
+const double *Lineq::gE_ortho_orb(int i) const
+{
+   return &E_ortho[i*2*L];
+}
+
+/**
+ * The ddot of two TPM's in orbital coordinates: m.m' + 4 u^T K u' with
+ * K = (L-2)*1 + J (J the matrix with all ones). See TPM::get_orbital_part.
+ * @param x first (m,u)
+ * @param y second (m,u)
+ * @return the ddot of the corresponding TPM's
+ */
+double Lineq::orb_ddot(const double *x, const double *y) const
+{
+   double res = 0;
+   double sum_x = 0;
+   double sum_y = 0;
+
+   for(int a=0;a<L;a++)
+   {
+      res += x[a] * y[a] + 4.0*(L-2) * x[L+a] * y[L+a];
+      sum_x += x[L+a];
+      sum_y += y[L+a];
+   }
+
+   return res + 4.0 * sum_x * sum_y;
+}
+
 namespace doci2DM
 {
    std::ostream &operator<<(std::ostream &output,doci2DM::Lineq &lineq_p)
@@ -174,156 +235,242 @@ namespace doci2DM
 }
 
 /**
- * orthogonalize the constraints, will take E and e, and construct E_ortho and e_ortho with them.
+ * @return true if the direct inverse of the overlap map is available
  */
-void Lineq::orthogonalize()
+bool Lineq::has_inverse_S() const
 {
-   //construct the overlapmatrix of the E's
-   Matrix S(E.size());
-
-   for(int i = 0;i < gnr();++i)
-      for(int j = i;j < gnr();++j)
-         S(i,j) = S(j,i) = E[i].ddot(E[j]);
-
-   //take the inverse square root
-   S.sqrt(-1);
-
-   // make room
-   E_ortho.reserve(gnr());
-   e_ortho.reserve(gnr());
-   // throw away old stuff (leave capacity unchanged)
-   E_ortho.clear();
-   e_ortho.clear();
-
-   //make the orthogonal ones:
-   for(int i=0;i<gnr();++i)
-   {
-      TPM ortho_constr(L,N);
-      ortho_constr = 0;
-
-      double tmp_e_ortho = 0;
-
-      for(int j = 0;j<gnr();++j)
-      {
-         ortho_constr.daxpy(S(i,j), E[j]);
-         tmp_e_ortho += S(i,j) * e[j];
-      }
-
-      E_ortho.push_back(std::move(ortho_constr));
-      e_ortho.push_back(tmp_e_ortho);
-   }
-
-   assert(E_ortho.size() == E.size());
+   return !S_inv.empty();
 }
 
 /**
- * access to the u_0 matrices
- * @param i the index of the specific u_0 matrix you are interested in.
- * @return u_0[i]
+ * @return the inverse of the overlap map on the orbital part of a TPM (column major, 2L x 2L)
  */
-const SUP &Lineq::gu_0(int i) const
+const double *Lineq::gS_inv() const
 {
-   return u_0[i];
+   return S_inv.data();
 }
 
 /**
- * access to the orthogonalized u_0 matrices
- * @param i the index of the specific u_0_ortho matrix you are interested in.
- * @return u_0_ortho[i]
+ * @return the eigenvalue of the overlap map on everything outside the orbital part
  */
-const SUP &Lineq::gu_0_ortho(int i) const
+double Lineq::gS_kappa() const
 {
-   return u_0_ortho[i];
+   return S_kappa;
 }
 
 /**
- * construct's the u_0 matrices with the input provided in the constructor. Again reusable code for the different constructers.
- * and again private because I say so.
+ * Construct the direct inverse of the overlap map on the space orthogonal to the constraints.
+ * The overlap map TPM::S is a multiple (S_kappa) of the identity on everything except
+ * the orbital part of a TPM (see TPM::get_orbital_part), which is only 2L dimensional.
+ * The constraints live entirely in this orbital part (they are stored that way). So we only have to invert
+ * a 2L x 2L matrix, projected on the complement of the constraints. All of this
+ * is checked numerically: if something doesn't match, S_inv stays empty and
+ * TPM::InverseS will fall back to the conjugate gradient method.
  */
-void Lineq::constr_u_0()
+void Lineq::constr_inverse_S()
 {
-   u_0.reserve(gnr());
+   S_inv.clear();
+   S_kappa = 0;
 
-   for(int i = 0;i < gnr();++i)
+   if(L < 3)
+      return;
+
+   const int dim = 2*L;
+   const int nr = gnr();
+   const double tol = 1e-10;
+
+   std::vector<double> mu(dim);
+
+   TPM basis(L,N);
+   TPM image(L,N);
+
+   // the overlap map in (m,u) coordinates
+   Matrix A(dim);
+
+   for(int i=0;i<dim;i++)
    {
-      SUP tmp(L,N);
+      std::fill(mu.begin(), mu.end(), 0);
+      mu[i] = 1;
+
+      basis = 0;
+      basis.add_orbital_part(1.0, mu.data());
+
+      image.S(basis);
 
-      tmp.fill(E_ortho[i]);
+      image.get_orbital_part(mu.data());
 
-      u_0.push_back(std::move(tmp));
+      for(int j=0;j<dim;j++)
+         A(j,i) = mu[j];
+
+      // nothing should end up outside the orbital part
+      image.add_orbital_part(-1.0, mu.data());
+
+      if(image.ddot(image) > tol)
+         return;
    }
 
-   assert(u_0.size() == E.size());
+   // find kappa with an off-diagonal element of the block
+   basis = 0;
+   basis(0,0,1) = basis(0,1,0) = 1;
+   image.S(basis);
+   S_kappa = image(0,0,1);
+
+   // check that it works on everything outside the orbital part
+   for(int i=0;i<basis.gdimMatrix(0);i++)
+      for(int j=i;j<basis.gdimMatrix(0);j++)
+         basis(0,i,j) = basis(0,j,i) = std::sin(1.0 + i + L*j);
+
+   for(int i=0;i<basis.gdimVector(0);i++)
+      basis(0,i) = std::cos(1.0 + 3*i);
+
+   basis.get_orbital_part(mu.data());
+   basis.add_orbital_part(-1.0, mu.data());
+
+   image.S(basis);
+   image.daxpy(-S_kappa, basis);
+
+   if(std::fabs(S_kappa) < tol || image.ddot(image) > tol*basis.ddot(basis))
+      return;
+
+   // the ddot in (m,u) coordinates is diag(1, 4K) with K = (L-2)*1 + J (J the all ones matrix)
+   // T is its square root, Ti the inverse of T
+   Matrix T(dim);
+   Matrix Ti(dim);
+   T = 0;
+   Ti = 0;
+
+   const double sq1 = std::sqrt(L-2.0);
+   const double sq2 = std::sqrt(2.0*L-2.0);
+
+   for(int a=0;a<L;a++)
+   {
+      T(a,a) = Ti(a,a) = 1;
+
+      for(int b=0;b<L;b++)
+      {
+         T(L+a,L+b) = 2.0 * ( (a==b ? sq1 : 0) + (sq2-sq1)/L );
+         Ti(L+a,L+b) = 0.5 * ( (a==b ? 1.0/sq1 : 0) + (1.0/sq2-1.0/sq1)/L );
+      }
+   }
+
+   // the overlap map in an orthonormal basis
+   Matrix hulp(dim);
+   Matrix At(dim);
+
+   hulp.mprod(A, Ti);
+   At.mprod(T, hulp);
+
+   for(int i=0;i<dim;i++)
+      for(int j=i+1;j<dim;j++)
+         At(i,j) = At(j,i) = 0.5 * (At(i,j) + At(j,i));
+
+   // the constraints in an orthonormal basis: Et = T E (dim x nr)
+   std::vector<double> Et(dim*nr);
+
+   char transN = 'N';
+   char transT = 'T';
+   double alpha = 1.0;
+   double beta = 0.0;
+
+   dgemm_(&transN,&transN,&dim,&nr,&dim,&alpha,T.gMatrix(),&dim,E.data(),&dim,&beta,Et.data(),&dim);
+
+   Matrix overlap(nr);
+
+   dgemm_(&transT,&transN,&nr,&nr,&dim,&alpha,Et.data(),&dim,Et.data(),&dim,&beta,overlap.gMatrix(),&nr);
+
+   overlap.symmetrize();
+   overlap.invert();
+
+   // the projector on the constraints: P_E = Et overlap^-1 Et^T
+   std::vector<double> EtO(dim*nr);
+
+   dgemm_(&transN,&transN,&dim,&nr,&nr,&alpha,Et.data(),&dim,overlap.gMatrix(),&nr,&beta,EtO.data(),&dim);
+
+   Matrix P_E(dim);
+
+   dgemm_(&transN,&transT,&dim,&dim,&nr,&alpha,EtO.data(),&dim,Et.data(),&dim,&beta,P_E.gMatrix(),&dim);
+
+   // the projector on the complement
+   Matrix P(dim);
+   P = 0;
+
+   for(int a=0;a<dim;a++)
+      P(a,a) = 1;
+
+   P -= P_E;
+
+   // B = P At P + P_E is invertible and B^-1 P is the inverse of P At P on the complement
+   Matrix B(dim);
+
+   hulp.mprod(At, P);
+   B.mprod(P, hulp);
+   B += P_E;
+
+   B.symmetrize();
+   B.invert();
+
+   // R = Ti B^-1 P T
+   Matrix R(dim);
+
+   hulp.mprod(P, T);
+   R.mprod(B, hulp);
+   hulp.mprod(Ti, R);
+
+   S_inv.assign(hulp.gMatrix(), hulp.gMatrix() + dim*dim);
 }
 
 /**
- * orthogonalize the u_0 matrices, will take the u_0's and construct the u_0_ortho's.
+ * orthogonalize the constraints, will take E and e, and construct E_ortho and e_ortho with them.
  */
-void Lineq::orthogonalize_u_0()
+void Lineq::orthogonalize()
 {
+   const int dim = 2*L;
+
    //construct the overlapmatrix of the E's
-   Matrix S(u_0.size());
+   Matrix S(gnr());
 
    for(int i = 0;i < gnr();++i)
       for(int j = i;j < gnr();++j)
-         S(i,j) = S(j,i) = u_0[i].ddot(u_0[j]);
+         S(i,j) = S(j,i) = orb_ddot(gE_orb(i), gE_orb(j));
 
    //take the inverse square root
    S.sqrt(-1);
 
-   // make room
-   u_0_ortho.reserve(gnr());
-   // throw away old stuff (leave capacity unchanged)
-   u_0_ortho.clear();
+   E_ortho.assign(gnr()*dim, 0);
+   e_ortho.assign(gnr(), 0);
 
    //make the orthogonal ones:
    for(int i=0;i<gnr();++i)
-   {
-      SUP ortho_constr(L,N);
-      ortho_constr = 0;
-
       for(int j = 0;j<gnr();++j)
-         ortho_constr.daxpy(S(i,j), u_0[j]);
+      {
+         for(int a=0;a<dim;a++)
+            E_ortho[i*dim+a] += S(i,j) * E[j*dim+a];
 
-      u_0_ortho.push_back(std::move(ortho_constr));
-   }
+         e_ortho[i] += S(i,j) * e[j];
+      }
+}
+
+/**
+ * access to the u_0 matrices, constructed on the fly
+ * @param i the index of the specific u_0 matrix you are interested in.
+ * @return u_0[i]
+ */
+SUP Lineq::gu_0(int i) const
+{
+   SUP tmp(L,N);
+
+   tmp.fill(gE_ortho(i));
 
-   assert(u_0_ortho.size() == E.size());
-//   //first allocate the u_0_ortho matrices:
-//   u_0_ortho = new SUP * [nr];
-//
-//   for(int i = 0;i < nr;++i)
-//      u_0_ortho[i] = new SUP(M,N);
-//
-//   //construct the overlapmatrix of the u_0's
-//   Matrix S(nr);
-//
-//   for(int i = 0;i < nr;++i)
-//      for(int j = i;j < nr;++j)
-//         S(i,j) = u_0[i]->ddot(*u_0[j]);
-//
-//   S.symmetrize();
-//
-//   //take the inverse square root
-//   S.sqrt(-1);
-//
-//   //make the orthogonal ones:
-//   for(int i = 0;i < nr;++i){
-//
-//      *u_0_ortho[i] = 0;//init
-//
-//      for(int j = 0;j < nr;++j)
-//         u_0_ortho[i]->daxpy(S(i,j),*u_0[j]);
-//
-//   }
+   return tmp;
 }
 
 void Lineq::check(const TPM &tpm) const
 {
    for(int i = 0;i < gnr();++i)
    {
-       std::cout << "constrain " << i << " gives " << tpm.ddot(gE(i)) << " = " << ge(i);
-       double tmp = fabs(tpm.ddot(gE(i)) - ge(i));
+       double proj = tpm.ddot(gE(i));
+       std::cout << "constrain " << i << " gives " << proj << " = " << ge(i);
+       double tmp = fabs(proj - ge(i));
        std::cout << ((tmp>1e-10) ? "\tFAILED" : "") << std::endl;
    }
 }
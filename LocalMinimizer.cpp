@@ -35,6 +35,8 @@
 #include "OptIndex.h"
 #include "BoundaryPoint.h"
 #include "PotentialReducation.h"
+#include "InteriorPoint.h"
+#include "OrbitalScan.h"
 
 // if set, the signal has been given to stop the minimalisation
 extern sig_atomic_t stopping_min;
@@ -54,6 +56,12 @@ simanneal::LocalMinimizer::LocalMinimizer(const CheMPS2::Hamiltonian &mol)
 
    conv_crit = 1e-6;
    conv_steps = 50;
+   scan_screening = 0;
+   coupled_iters = 100;
+   max_steps = 1000;
+   do_output = true;
+   save_steps = true;
+   did_converge = false;
 
    std::random_device rd;
    mt = std::mt19937(rd());
@@ -112,6 +120,12 @@ simanneal::LocalMinimizer::LocalMinimizer(CheMPS2::Hamiltonian &&mol)
 
    conv_crit = 1e-6;
    conv_steps = 50;
+   scan_screening = 0;
+   coupled_iters = 100;
+   max_steps = 1000;
+   do_output = true;
+   save_steps = true;
+   did_converge = false;
 
    std::random_device rd;
    mt = std::mt19937(rd());
@@ -217,17 +231,20 @@ void simanneal::LocalMinimizer::UsePotentialReduction()
    method.reset(new doci2DM::PotentialReduction(*ham));
 }
 
-std::vector< std::tuple<int,int,double,double> > simanneal::LocalMinimizer::scan_orbitals()
+void simanneal::LocalMinimizer::UseInteriorPoint()
 {
-   auto start = std::chrono::high_resolution_clock::now();
-
-   const auto& ham2 = *ham;
-   std::function<double(int,int)> getT = [&ham2] (int a, int b) -> double { return ham2.getTmat(a,b); };
-   std::function<double(int,int,int,int)> getV = [&ham2]  (int a, int b, int c, int d) -> double { return ham2.getVmat(a,b,c,d); };
+   method.reset(new doci2DM::InteriorPoint(*ham));
+}
 
-   std::vector< std::tuple<int,int,double,double> > pos_rotations;
+/**
+ * @return all the orbital pairs (k,l) with k<l that can be rotated: the same irrep and
+ * in the allowed irreps
+ */
+std::vector< std::pair<int,int> > simanneal::LocalMinimizer::orbital_pairs() const
+{
+   std::vector< std::pair<int,int> > pairs;
    // worst case: c1 symmetry
-   pos_rotations.reserve(ham->getL()*(ham->getL()-1)/2);
+   pairs.reserve(ham->getL()*(ham->getL()-1)/2);
 
    for(int k_in=0;k_in<ham->getL();k_in++)
       for(int l_in=k_in+1;l_in<ham->getL();l_in++)
@@ -236,30 +253,28 @@ std::vector< std::tuple<int,int,double,double> > simanneal::LocalMinimizer::scan
             if(!allow_irreps.empty() && std::find(allow_irreps.begin(), allow_irreps.end(), ham->getOrbitalIrrep(k_in)) == allow_irreps.end() )
                continue;
 
-            auto found = method->getRDM().find_min_angle(k_in,l_in,0.3,getT,getV);
+            pairs.push_back(std::make_pair(k_in,l_in));
+         }
 
-            if(!found.second)
-               // we hit a maximum
-               found = method->getRDM().find_min_angle(k_in,l_in,0.01,getT,getV);
+   return pairs;
+}
 
-            if(!found.second)
-               // we're still stuck in a maximum, skip this!
-               continue;
+std::vector< std::tuple<int,int,double,double> > simanneal::LocalMinimizer::scan_orbitals()
+{
+   auto start = std::chrono::high_resolution_clock::now();
 
-            // skip angles larger than Pi/2
-            if(fabs(found.first)>M_PI/2.0)
-               continue;
+   const doci2DM::DociIntegrals ints(*ham);
 
-            double new_en = method->getRDM().calc_rotate(k_in,l_in,found.first,getT,getV);
+   const auto pairs = orbital_pairs();
 
-            assert(found.second && "Shit, maximum!");
+   const doci2DM::OrbitalScan scanner(method->getRDM(), ints);
 
-            pos_rotations.push_back(std::make_tuple(k_in,l_in,found.first,new_en));
-         }
+   auto pos_rotations = scanner.scan(pairs, scan_screening);
 
    auto end = std::chrono::high_resolution_clock::now();
 
-   std::cout << "Orbital scanning took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
+   if(do_output)
+      std::cout << "Orbital scanning took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
 
    assert(pos_rotations.size()>0);
 
@@ -298,8 +313,9 @@ int simanneal::LocalMinimizer::Minimize(bool dist_choice, int start_iters)
             return std::get<3>(a) < std::get<3>(b);
             });
 
-      for(auto& elem: list_rots)
-         std::cout << std::get<0>(elem) << "\t" << std::get<1>(elem) << "\t" << std::get<3>(elem)+ham->getEconst() << "\t" << std::get<2>(elem) << std::endl;
+      if(do_output)
+         for(auto& elem: list_rots)
+            std::cout << std::get<0>(elem) << "\t" << std::get<1>(elem) << "\t" << std::get<3>(elem)+ham->getEconst() << "\t" << std::get<2>(elem) << std::endl;
 
       int idx = 0;
       std::pair<int,int> tmp;
@@ -328,7 +344,7 @@ int simanneal::LocalMinimizer::Minimize(bool dist_choice, int start_iters)
       const auto& new_rot = list_rots[idx];
       prev_pair = std::make_pair(std::get<0>(new_rot), std::get<1>(new_rot));
 
-      if(dist_choice)
+      if(dist_choice && do_output)
          std::cout << iters << " (" << converged << ") Chosen: " << idx << std::endl;
 
       assert(ham->getOrbitalIrrep(std::get<0>(new_rot)) == ham->getOrbitalIrrep(std::get<1>(new_rot)));
@@ -336,49 +352,218 @@ int simanneal::LocalMinimizer::Minimize(bool dist_choice, int start_iters)
       orbtrans->DoJacobiRotation(*ham, std::get<0>(new_rot), std::get<1>(new_rot), std::get<2>(new_rot));
       orbtrans->get_unitary().jacobi_rotation(ham->getOrbitalIrrep(std::get<0>(new_rot)), std::get<0>(new_rot), std::get<1>(new_rot), std::get<2>(new_rot));
 
+      // rotate the start point of the boundary point method into the new basis
+      if(obj_bp)
+         obj_bp->rotate(std::get<0>(new_rot), std::get<1>(new_rot), std::get<2>(new_rot));
+
+      new_energy = calc_new_energy(*ham);
+
+      if(save_steps)
+      {
+         std::stringstream h5_name;
+         h5_name << getenv("SAVE_H5_PATH") << "/unitary-" << start_iters+iters << ".h5";
+         orbtrans->get_unitary().saveU(h5_name.str());
+
+         h5_name.str("");
+         h5_name << getenv("SAVE_H5_PATH") << "/ham-" << start_iters+iters << ".h5";
+         ham->save2(h5_name.str());
 
-      // start from zero every 25 iterations
-      if(obj_bp && iters%25==0)
+         h5_name.str("");
+         h5_name << getenv("SAVE_H5_PATH") << "/rdm-" << start_iters+iters << ".h5";
+         method->getRDM().WriteToFile(h5_name.str());
+
+         if(obj_bp)
+         {
+            h5_name.str("");
+            h5_name << getenv("SAVE_H5_PATH") << "/X-" << start_iters+iters << ".h5";
+            obj_bp->getX().WriteToFile(h5_name.str());
+
+            h5_name.str("");
+            h5_name << getenv("SAVE_H5_PATH") << "/Z-" << start_iters+iters << ".h5";
+            obj_bp->getZ().WriteToFile(h5_name.str());
+         }
+      }
+
+      if(method->FullyConverged())
       {
-         std::cout << "Restarting from zero" << std::endl;
-         obj_bp->getX() = 0;
-         obj_bp->getZ() = 0;
+         if(fabs(energy-new_energy)<conv_crit)
+            converged++;
       }
 
-      new_energy = calc_new_energy(*ham);
+      if(do_output)
+         std::cout << iters << " (" << converged << ")\tRotation between " << std::get<0>(new_rot) << "  " << std::get<1>(new_rot) << " over " << std::get<2>(new_rot) << " E_rot = " << std::get<3>(new_rot)+ham->getEconst() << "  E = " << new_energy+ham->getEconst() << "\t" << fabs(energy-new_energy) << std::endl;
+
+
+      energy = new_energy;
+
+      iters++;
+
+      if(iters>max_steps)
+      {
+         if(do_output)
+            std::cout << "Done " << max_steps << " steps, quiting..." << std::endl;
+         break;
+      }
+
+      if(stopping_min)
+         break;
+   }
 
+   did_converge = (converged >= conv_steps);
+
+   auto end = std::chrono::high_resolution_clock::now();
+
+   if(do_output)
+      std::cout << "Minimization took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
+
+   if(save_steps)
+   {
       std::stringstream h5_name;
-      h5_name << getenv("SAVE_H5_PATH") << "/unitary-" << start_iters+iters << ".h5";
-      orbtrans->get_unitary().saveU(h5_name.str());
+      h5_name << getenv("SAVE_H5_PATH") << "/optimale-uni.h5";
+      get_Optimal_Unitary().saveU(h5_name.str());
+   }
 
-      h5_name.str("");
-      h5_name << getenv("SAVE_H5_PATH") << "/ham-" << start_iters+iters << ".h5";
-      ham->save2(h5_name.str());
+   return iters;
+}
 
-      h5_name.str("");
-      h5_name << getenv("SAVE_H5_PATH") << "/rdm-" << start_iters+iters << ".h5";
-      method->getRDM().WriteToFile(h5_name.str());
+/**
+ * Do the local minimization with sweeps: in every iteration, a maximal set of disjoint
+ * orbital pairs that each lower the energy is rotated at once, and the SDP is only
+ * solved once per sweep. Because the predictions of the different pairs are made
+ * independently, a sweep that doesn't lower the energy is undone and replaced by
+ * only the best rotation.
+ * @param start_iters start number the iterations from this number (defaults to 0)
+ * @return the number of sweeps
+ */
+int simanneal::LocalMinimizer::Minimize_sweep(int start_iters)
+{
+   int converged = 0;
+   double new_energy;
+
+   // first run
+   energy = calc_new_energy();
+
+   auto start = std::chrono::high_resolution_clock::now();
+
+   int iters = 1;
+   int nr_rotations = 0;
+
+   doci2DM::BoundaryPoint *obj_bp = dynamic_cast<doci2DM::BoundaryPoint *> (method.get());
+
+   while(converged<conv_steps)
+   {
+      auto list_rots = scan_orbitals();
+
+      std::sort(list_rots.begin(), list_rots.end(),
+            [](const std::tuple<int,int,double,double> & a, const std::tuple<int,int,double,double> & b) -> bool
+            {
+            return std::get<3>(a) < std::get<3>(b);
+            });
+
+      // greedy: take the best pairs that lower the energy and don't share an orbital
+      std::vector<bool> used(ham->getL(), false);
+      std::vector<JacobiRotation> sweep;
+      double predicted = energy;
+
+      for(auto& elem: list_rots)
+      {
+         const int k = std::get<0>(elem);
+         const int l = std::get<1>(elem);
+
+         if(std::get<3>(elem) >= energy)
+            break;
+
+         if(used[k] || used[l])
+            continue;
+
+         used[k] = used[l] = true;
+         sweep.push_back(std::make_tuple(ham->getOrbitalIrrep(k), k, l, std::get<2>(elem)));
+         predicted += std::get<3>(elem) - energy;
+
+         if(do_output)
+            std::cout << k << "\t" << l << "\t" << std::get<3>(elem)+ham->getEconst() << "\t" << std::get<2>(elem) << std::endl;
+      }
+
+      // nothing lowers the energy: do the best rotation anyway, like Minimize()
+      if(sweep.empty())
+      {
+         const auto& best = list_rots[0];
+         sweep.push_back(std::make_tuple(ham->getOrbitalIrrep(std::get<0>(best)), std::get<0>(best), std::get<1>(best), std::get<2>(best)));
+         predicted = std::get<3>(best);
+      }
+
+      // do the rotations twice: once for the Hamiltonian data and once for the Unitary Matrix
+      orbtrans->DoJacobiRotations(*ham, sweep);
+      orbtrans->get_unitary().jacobi_rotations(sweep);
+
+      // keep the start point of the boundary point method in case we have to undo the sweep
+      std::unique_ptr<doci2DM::SUP> prev_X, prev_Z;
 
       if(obj_bp)
       {
-         // if energy goes up instead of down, reset the start point
-         if((std::get<3>(new_rot) - new_energy) < -1e-5)
+         prev_X.reset(new doci2DM::SUP(obj_bp->getX()));
+         prev_Z.reset(new doci2DM::SUP(obj_bp->getZ()));
+
+         for(auto &rot: sweep)
+            obj_bp->rotate(std::get<1>(rot), std::get<2>(rot), std::get<3>(rot));
+      }
+
+      new_energy = calc_new_energy(*ham);
+
+      // an increase below conv_crit is within the accuracy of the SDP solution
+      if(sweep.size() > 1 && new_energy > energy + conv_crit)
+      {
+         if(do_output)
+            std::cout << "Sweep of " << sweep.size() << " rotations went up: " << new_energy-energy << ", only doing the best one" << std::endl;
+
+         // undo the sweep and do only the first (best) rotation
+         std::vector<JacobiRotation> undo;
+         for(auto it = sweep.rbegin(); it != sweep.rend(); ++it)
+            undo.push_back(std::make_tuple(std::get<0>(*it), std::get<1>(*it), std::get<2>(*it), -1*std::get<3>(*it)));
+         undo.push_back(sweep[0]);
+
+         orbtrans->DoJacobiRotations(*ham, undo);
+         orbtrans->get_unitary().jacobi_rotations(undo);
+
+         if(obj_bp)
          {
-            std::cout << "Restarting from zero because too much up: " << std::get<3>(new_rot) - new_energy << std::endl;
-            obj_bp->getX() = 0;
-            obj_bp->getZ() = 0;
-            obj_bp->Run();
-            std::cout << "After restarting found: " << obj_bp->getEnergy() << " vs " << new_energy << "\t" << obj_bp->getEnergy()-new_energy << std::endl;
-            new_energy = obj_bp->getEnergy();
+            obj_bp->getX() = std::move(*prev_X);
+            obj_bp->getZ() = std::move(*prev_Z);
+            obj_bp->rotate(std::get<1>(sweep[0]), std::get<2>(sweep[0]), std::get<3>(sweep[0]));
          }
 
+         sweep.resize(1);
+         predicted = std::get<3>(list_rots[0]);
+
+         new_energy = calc_new_energy(*ham);
+      }
+
+      nr_rotations += sweep.size();
+
+      if(save_steps)
+      {
+         std::stringstream h5_name;
+         h5_name << getenv("SAVE_H5_PATH") << "/unitary-" << start_iters+iters << ".h5";
+         orbtrans->get_unitary().saveU(h5_name.str());
+
          h5_name.str("");
-         h5_name << getenv("SAVE_H5_PATH") << "/X-" << start_iters+iters << ".h5";
-         obj_bp->getX().WriteToFile(h5_name.str());
+         h5_name << getenv("SAVE_H5_PATH") << "/ham-" << start_iters+iters << ".h5";
+         ham->save2(h5_name.str());
 
          h5_name.str("");
-         h5_name << getenv("SAVE_H5_PATH") << "/Z-" << start_iters+iters << ".h5";
-         obj_bp->getZ().WriteToFile(h5_name.str());
+         h5_name << getenv("SAVE_H5_PATH") << "/rdm-" << start_iters+iters << ".h5";
+         method->getRDM().WriteToFile(h5_name.str());
+
+         if(obj_bp)
+         {
+            h5_name.str("");
+            h5_name << getenv("SAVE_H5_PATH") << "/X-" << start_iters+iters << ".h5";
+            obj_bp->getX().WriteToFile(h5_name.str());
+
+            h5_name.str("");
+            h5_name << getenv("SAVE_H5_PATH") << "/Z-" << start_iters+iters << ".h5";
+            obj_bp->getZ().WriteToFile(h5_name.str());
+         }
       }
 
       if(method->FullyConverged())
@@ -387,16 +572,172 @@ int simanneal::LocalMinimizer::Minimize(bool dist_choice, int start_iters)
             converged++;
       }
 
-      std::cout << iters << " (" << converged << ")\tRotation between " << std::get<0>(new_rot) << "  " << std::get<1>(new_rot) << " over " << std::get<2>(new_rot) << " E_rot = " << std::get<3>(new_rot)+ham->getEconst() << "  E = " << new_energy+ham->getEconst() << "\t" << fabs(energy-new_energy) << std::endl;
+      if(do_output)
+         std::cout << iters << " (" << converged << ")\tSweep with " << sweep.size() << " rotations: E_pred = " << predicted+ham->getEconst() << "  E = " << new_energy+ham->getEconst() << "\t" << fabs(energy-new_energy) << std::endl;
+
+      energy = new_energy;
+
+      iters++;
+
+      if(iters>max_steps)
+      {
+         if(do_output)
+            std::cout << "Done " << max_steps << " sweeps, quiting..." << std::endl;
+         break;
+      }
+
+      if(stopping_min)
+         break;
+   }
+
+   did_converge = (converged >= conv_steps);
+
+   auto end = std::chrono::high_resolution_clock::now();
+
+   if(do_output)
+      std::cout << "Minimization with sweeps took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s (" << nr_rotations << " rotations in " << iters-1 << " sweeps)" << std::endl;
+
+   if(save_steps)
+   {
+      std::stringstream h5_name;
+      h5_name << getenv("SAVE_H5_PATH") << "/optimale-uni.h5";
+      get_Optimal_Unitary().saveU(h5_name.str());
+   }
+
+   return iters;
+}
+
+/**
+ * Do the local minimization with speculative verification: the SDP is solved for the
+ * nr_candidates best rotations of the scan at the same time, each in its own thread and
+ * with its own copy of the method. The rotation with the lowest verified energy is kept.
+ * Every candidate logs its SDP runs to SAVE_H5_PATH/speculative-c.txt (or to the
+ * current directory when SAVE_H5_PATH isn't set).
+ * @param nr_candidates the number of rotations to verify in every iteration
+ * @param start_iters start number the iterations from this number (defaults to 0)
+ * @return the number of iterations
+ */
+int simanneal::LocalMinimizer::Minimize_speculative(int nr_candidates, int start_iters)
+{
+   int converged = 0;
+   double new_energy;
+
+   // first run
+   energy = calc_new_energy();
 
+   // the candidates run concurrently, so each one needs its own file: never fall back on std::cout
+   const char *save_path = getenv("SAVE_H5_PATH");
+   const std::string log_dir = save_path ? save_path : ".";
+
+   auto start = std::chrono::high_resolution_clock::now();
+
+   std::pair<int,int> prev_pair(0,0);
+
+   int iters = 1;
+
+   while(converged<conv_steps)
+   {
+      auto list_rots = scan_orbitals();
+
+      std::sort(list_rots.begin(), list_rots.end(),
+            [](const std::tuple<int,int,double,double> & a, const std::tuple<int,int,double,double> & b) -> bool
+            {
+            return std::get<3>(a) < std::get<3>(b);
+            });
+
+      // the best rotations, but don't do the same pair twice in a row
+      std::vector< std::tuple<int,int,double,double> > candidates;
+      for(auto& elem: list_rots)
+      {
+         if(candidates.size() >= (unsigned int) nr_candidates)
+            break;
+
+         if(std::make_pair(std::get<0>(elem), std::get<1>(elem)) != prev_pair)
+            candidates.push_back(elem);
+      }
+
+      const int nc = candidates.size();
+
+      // every candidate gets its own hamiltonian and a copy of the current method (the warm start)
+      std::vector< std::unique_ptr<CheMPS2::Hamiltonian> > cand_hams(nc);
+      std::vector< std::unique_ptr<doci2DM::Method> > cand_methods(nc);
+      std::vector<double> verified(nc);
+
+      for(int c=0;c<nc;c++)
+      {
+         const auto& rot = candidates[c];
+
+         cand_hams[c].reset(new CheMPS2::Hamiltonian(*ham));
+         orbtrans->DoJacobiRotation(*cand_hams[c], std::get<0>(rot), std::get<1>(rot), std::get<2>(rot));
+
+         cand_methods[c].reset(method->Clone());
+
+         cand_methods[c]->set_outfile(log_dir + "/speculative-" + std::to_string(c) + ".txt");
+
+         doci2DM::BoundaryPoint *cand_bp = dynamic_cast<doci2DM::BoundaryPoint *> (cand_methods[c].get());
+         if(cand_bp)
+            cand_bp->rotate(std::get<0>(rot), std::get<1>(rot), std::get<2>(rot));
+
+         cand_methods[c]->BuildHam(*cand_hams[c]);
+      }
+
+#pragma omp parallel for schedule(dynamic)
+      for(int c=0;c<nc;c++)
+      {
+         cand_methods[c]->Run();
+         verified[c] = cand_methods[c]->getEnergy();
+      }
+
+      const int best = std::min_element(verified.begin(), verified.end()) - verified.begin();
+
+      if(do_output)
+         for(int c=0;c<nc;c++)
+            std::cout << std::get<0>(candidates[c]) << "\t" << std::get<1>(candidates[c]) << "\t" << std::get<2>(candidates[c]) << "\tE_rot = " << std::get<3>(candidates[c])+ham->getEconst() << "\tE = " << verified[c]+ham->getEconst() << (c==best ? "\t<=" : "") << std::endl;
+
+      const auto& new_rot = candidates[best];
+      prev_pair = std::make_pair(std::get<0>(new_rot), std::get<1>(new_rot));
+
+      // keep the verified candidate: the rotated hamiltonian, the solution and the unitary
+      const std::string outfile = method->get_outfile();
+      ham = std::move(cand_hams[best]);
+      method = std::move(cand_methods[best]);
+      method->set_outfile(outfile);
+      orbtrans->get_unitary().jacobi_rotation(ham->getOrbitalIrrep(std::get<0>(new_rot)), std::get<0>(new_rot), std::get<1>(new_rot), std::get<2>(new_rot));
+
+      new_energy = verified[best];
+
+      if(save_steps)
+      {
+         std::stringstream h5_name;
+         h5_name << getenv("SAVE_H5_PATH") << "/unitary-" << start_iters+iters << ".h5";
+         orbtrans->get_unitary().saveU(h5_name.str());
+
+         h5_name.str("");
+         h5_name << getenv("SAVE_H5_PATH") << "/ham-" << start_iters+iters << ".h5";
+         ham->save2(h5_name.str());
+
+         h5_name.str("");
+         h5_name << getenv("SAVE_H5_PATH") << "/rdm-" << start_iters+iters << ".h5";
+         method->getRDM().WriteToFile(h5_name.str());
+      }
+
+      if(method->FullyConverged())
+      {
+         if(fabs(energy-new_energy)<conv_crit)
+            converged++;
+      }
+
+      if(do_output)
+         std::cout << iters << " (" << converged << ")\tRotation between " << std::get<0>(new_rot) << "  " << std::get<1>(new_rot) << " over " << std::get<2>(new_rot) << " (candidate " << best << " of " << nc << ") E_rot = " << std::get<3>(new_rot)+ham->getEconst() << "  E = " << new_energy+ham->getEconst() << "\t" << fabs(energy-new_energy) << std::endl;
 
       energy = new_energy;
 
       iters++;
 
-      if(iters>1000)
+      if(iters>max_steps)
       {
-         std::cout << "Done 1000 steps, quiting..." << std::endl;
+         if(do_output)
+            std::cout << "Done " << max_steps << " steps, quiting..." << std::endl;
          break;
       }
 
@@ -404,17 +745,205 @@ int simanneal::LocalMinimizer::Minimize(bool dist_choice, int start_iters)
          break;
    }
 
+   did_converge = (converged >= conv_steps);
+
    auto end = std::chrono::high_resolution_clock::now();
 
-   std::cout << "Minimization took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
+   if(do_output)
+      std::cout << "Speculative minimization took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
 
-   std::stringstream h5_name;
-   h5_name << getenv("SAVE_H5_PATH") << "/optimale-uni.h5";
-   get_Optimal_Unitary().saveU(h5_name.str());
+   if(save_steps)
+   {
+      std::stringstream h5_name;
+      h5_name << getenv("SAVE_H5_PATH") << "/optimale-uni.h5";
+      get_Optimal_Unitary().saveU(h5_name.str());
+   }
 
    return iters;
 }
 
+/**
+ * Do the local minimization with the orbital steps and the boundary point iterations
+ * interleaved: after every orbital rotation only a bounded number of primal iterations
+ * is done, with a tolerance that is tightened as the orbital gradient shrinks. The SDP
+ * is only solved to the full tolerance at the end. Only works with BoundaryPoint, for the
+ * other methods this is the same as Minimize().
+ * @param start_iters start number the iterations from this number (defaults to 0)
+ * @return the number of iterations
+ */
+int simanneal::LocalMinimizer::Minimize_coupled(int start_iters)
+{
+   doci2DM::BoundaryPoint *obj_bp = dynamic_cast<doci2DM::BoundaryPoint *> (method.get());
+
+   if(!obj_bp)
+      return Minimize(false, start_iters);
+
+   const double final_tol = obj_bp->get_tol_PD();
+   // the tolerance to start from
+   double tol = std::max(final_tol, 1e-3);
+
+   obj_bp->set_tol_PD(tol);
+   obj_bp->set_max_primal_iter(coupled_iters);
+
+   int converged = 0;
+   double new_energy;
+   unsigned int tot_primal = 0;
+
+   // first run
+   orbtrans->fillHamCI(*ham);
+   method->BuildHam(*ham);
+   tot_primal += method->Run();
+   energy = method->getEnergy();
+
+   auto start = std::chrono::high_resolution_clock::now();
+
+   const auto pairs = orbital_pairs();
+
+   std::pair<int,int> prev_pair(0,0);
+
+   int iters = 1;
+
+   while(converged<conv_steps)
+   {
+      std::vector< std::tuple<int,int,double,double> > list_rots;
+      std::vector<double> grad, hess;
+
+      {
+         const doci2DM::DociIntegrals ints(*ham);
+         const doci2DM::OrbitalScan scanner(method->getRDM(), ints);
+
+         list_rots = scanner.scan(pairs, scan_screening);
+         scanner.gradient(pairs, grad, hess);
+      }
+
+      double max_grad = 0;
+      for(auto &elem: grad)
+         max_grad = std::max(max_grad, fabs(elem));
+
+      // tighten the tolerance together with the orbital gradient
+      tol = std::max(final_tol, std::min(tol, 1e-2*max_grad));
+      obj_bp->set_tol_PD(tol);
+
+      assert(list_rots.size()>0);
+
+      std::sort(list_rots.begin(), list_rots.end(),
+            [](const std::tuple<int,int,double,double> & a, const std::tuple<int,int,double,double> & b) -> bool
+            {
+            return std::get<3>(a) < std::get<3>(b);
+            });
+
+      int idx = 0;
+
+      // don't do the same pair twice in a row
+      if(std::make_pair(std::get<0>(list_rots[0]), std::get<1>(list_rots[0])) == prev_pair && list_rots.size() > 1)
+         idx++;
+
+      const auto& new_rot = list_rots[idx];
+      prev_pair = std::make_pair(std::get<0>(new_rot), std::get<1>(new_rot));
+
+      orbtrans->DoJacobiRotation(*ham, std::get<0>(new_rot), std::get<1>(new_rot), std::get<2>(new_rot));
+      orbtrans->get_unitary().jacobi_rotation(ham->getOrbitalIrrep(std::get<0>(new_rot)), std::get<0>(new_rot), std::get<1>(new_rot), std::get<2>(new_rot));
+      obj_bp->rotate(std::get<0>(new_rot), std::get<1>(new_rot), std::get<2>(new_rot));
+
+      method->BuildHam(*ham);
+      tot_primal += method->Run();
+      new_energy = method->getEnergy();
+
+      if(tol <= final_tol && method->FullyConverged() && fabs(energy-new_energy)<conv_crit)
+         converged++;
+
+      if(do_output)
+         std::cout << iters << " (" << converged << ")\tRotation between " << std::get<0>(new_rot) << "  " << std::get<1>(new_rot) << " over " << std::get<2>(new_rot) << " |g| = " << max_grad << " tol = " << tol << " E_rot = " << std::get<3>(new_rot)+ham->getEconst() << "  E = " << new_energy+ham->getEconst() << "\t" << fabs(energy-new_energy) << std::endl;
+
+      energy = new_energy;
+
+      iters++;
+
+      if(iters>max_steps)
+      {
+         if(do_output)
+            std::cout << "Done " << max_steps << " steps, quiting..." << std::endl;
+         break;
+      }
+
+      if(stopping_min)
+         break;
+   }
+
+   // and finally converge the SDP for the last orbitals
+   obj_bp->set_tol_PD(final_tol);
+   obj_bp->set_max_primal_iter(0);
+   tot_primal += method->Run();
+   energy = method->getEnergy();
+
+   did_converge = (converged >= conv_steps);
+
+   auto end = std::chrono::high_resolution_clock::now();
+
+   if(do_output)
+      std::cout << "Coupled minimization took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s (" << tot_primal << " primal iterations)" << std::endl;
+
+   if(save_steps)
+   {
+      std::stringstream h5_name;
+      h5_name << getenv("SAVE_H5_PATH") << "/unitary-" << start_iters+iters << ".h5";
+      orbtrans->get_unitary().saveU(h5_name.str());
+
+      h5_name.str("");
+      h5_name << getenv("SAVE_H5_PATH") << "/rdm-" << start_iters+iters << ".h5";
+      method->getRDM().WriteToFile(h5_name.str());
+
+      h5_name.str("");
+      h5_name << getenv("SAVE_H5_PATH") << "/optimale-uni.h5";
+      get_Optimal_Unitary().saveU(h5_name.str());
+   }
+
+   return iters;
+}
+
+/**
+ * @param iters the number of primal iterations of the boundary point method
+ * after every orbital step in Minimize_coupled()
+ */
+void simanneal::LocalMinimizer::set_coupled_iters(unsigned int iters)
+{
+   coupled_iters = iters;
+}
+
+/**
+ * @param steps the maximal number of orbital steps in one call of one of the Minimize_* modes
+ */
+void simanneal::LocalMinimizer::set_max_steps(int steps)
+{
+   max_steps = steps;
+}
+
+/**
+ * @param out print the progress of the Minimize_* modes and scan_orbitals() or not
+ */
+void simanneal::LocalMinimizer::set_output(bool out)
+{
+   do_output = out;
+}
+
+/**
+ * @param save write the unitary, hamiltonian and rdm of every step of
+ * the Minimize_* modes to SAVE_H5_PATH or not
+ */
+void simanneal::LocalMinimizer::set_save_steps(bool save)
+{
+   save_steps = save;
+}
+
+/**
+ * @return true if the last call of one of the Minimize_* modes stopped because
+ * it converged, false if it hit max_steps or was interrupted
+ */
+bool simanneal::LocalMinimizer::Converged() const
+{
+   return did_converge;
+}
+
 double simanneal::LocalMinimizer::get_conv_crit() const
 {
    return conv_crit;
@@ -430,6 +959,15 @@ void simanneal::LocalMinimizer::set_conv_steps(int steps)
    conv_steps = steps;
 }
 
+/**
+ * Skip the orbital pairs with a small exchange integral in scan_orbitals()
+ * @param screen the threshold for |V(k,l,l,k)|, 0 to scan all pairs
+ */
+void simanneal::LocalMinimizer::set_scan_screening(double screen)
+{
+   scan_screening = screen;
+}
+
 /**
  * Choose a pair of orbitals to rotate over, according to the distribution of their relative
  * energy change.
@@ -486,8 +1024,9 @@ int simanneal::LocalMinimizer::Minimize_noOpt(double stopcrit)
             return std::get<3>(a) < std::get<3>(b);
             });
 
-      for(auto& elem: list_rots)
-         std::cout << std::get<0>(elem) << "\t" << std::get<1>(elem) << "\t" << std::get<3>(elem)+ham->getEconst() << "\t" << std::get<2>(elem) << std::endl;
+      if(do_output)
+         for(auto& elem: list_rots)
+            std::cout << std::get<0>(elem) << "\t" << std::get<1>(elem) << "\t" << std::get<3>(elem)+ham->getEconst() << "\t" << std::get<2>(elem) << std::endl;
 
       int idx = 0;
       std::pair<int,int> tmp;
@@ -508,7 +1047,8 @@ int simanneal::LocalMinimizer::Minimize_noOpt(double stopcrit)
 
       energy = std::get<3>(new_rot);
 
-      std::cout << iters << " (" << converged << ")\tRotation between " << std::get<0>(new_rot) << "  " << std::get<1>(new_rot) << " over " << std::get<2>(new_rot) << " E_rot = " << energy+ham->getEconst() << "\t" << old_energy-energy << std::endl;
+      if(do_output)
+         std::cout << iters << " (" << converged << ")\tRotation between " << std::get<0>(new_rot) << "  " << std::get<1>(new_rot) << " over " << std::get<2>(new_rot) << " E_rot = " << energy+ham->getEconst() << "\t" << old_energy-energy << std::endl;
 
       iters++;
 
@@ -519,7 +1059,8 @@ int simanneal::LocalMinimizer::Minimize_noOpt(double stopcrit)
 
       if(iters>10000)
       {
-         std::cout << "Done 10000 steps, quiting..." << std::endl;
+         if(do_output)
+            std::cout << "Done 10000 steps, quiting..." << std::endl;
          break;
       }
 
@@ -527,13 +1068,19 @@ int simanneal::LocalMinimizer::Minimize_noOpt(double stopcrit)
          break;
    }
 
+   did_converge = (converged >= conv_steps);
+
    auto end = std::chrono::high_resolution_clock::now();
 
-   std::cout << "Minimization without optimization took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
+   if(do_output)
+      std::cout << "Minimization without optimization took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
 
-   std::stringstream h5_name;
-   h5_name << getenv("SAVE_H5_PATH") << "/optimale-uni-no-opt.h5";
-   get_Optimal_Unitary().saveU(h5_name.str());
+   if(save_steps)
+   {
+      std::stringstream h5_name;
+      h5_name << getenv("SAVE_H5_PATH") << "/optimale-uni-no-opt.h5";
+      get_Optimal_Unitary().saveU(h5_name.str());
+   }
 
    return iters;
 }
@@ -0,0 +1,217 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cmath>
+#include <signal.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "MultiStart.h"
+#include "OptIndex.h"
+#include "UnitaryMatrix.h"
+#include "BoundaryPoint.h"
+
+// if set, the signal has been given to stop the minimalisation
+extern sig_atomic_t stopping_min;
+
+/**
+ * Set up all the starts. This is done serially: the random unitaries
+ * and the static tables of the TPM/PHM are not thread safe.
+ * @param mol the molecular data to use
+ * @param nr_starts the number of starts (including the original orbitals)
+ */
+simanneal::MultiStart::MultiStart(const CheMPS2::Hamiltonian &mol, int nr_starts)
+{
+   nr_starts = std::max(1, nr_starts);
+
+   threads = std::max(1U, std::thread::hardware_concurrency());
+   stage_steps = 20;
+   keep_fraction = 0.5;
+   best = 0;
+
+   const OptIndex index(mol);
+
+   starts.resize(nr_starts);
+   energies.resize(nr_starts, 0);
+
+   // the starts run concurrently, so each one needs its own file: never fall back on std::cout
+   const char *save_path = getenv("SAVE_H5_PATH");
+   const std::string log_dir = save_path ? save_path : ".";
+
+   for(int i=0;i<nr_starts;i++)
+   {
+      starts[i].reset(new LocalMinimizer(mol));
+
+      auto &start = *starts[i];
+
+      // only one copy of the original two-body integrals
+      start.getOrbitalTf().share_original(starts[0]->getOrbitalTf());
+
+      if(i > 0)
+      {
+         UnitaryMatrix X(index);
+         X.fill_random();
+         X.make_skew_symmetric();
+         start.getOrbitalTf().update_unitary(X, false);
+      }
+
+      start.getMethod_BP().set_use_prev_result(true);
+      start.getMethod_BP().set_tol_PD(1e-7);
+      start.set_conv_steps(10);
+      start.set_conv_crit(1e-6);
+
+      // HDF5 isn't thread safe and the starts would overwrite each others files
+      start.set_save_steps(false);
+      start.set_output(false);
+
+      start.getMethod().set_outfile(log_dir + "/multistart-" + std::to_string(i) + ".txt");
+   }
+}
+
+simanneal::MultiStart::~MultiStart() = default;
+
+/**
+ * Run all the starts. In every stage, every active start does at most stage_steps
+ * orbital steps. A start that converged in a stage is done. Of the others, only the
+ * best keep_fraction (at least one) goes on to the next stage.
+ * @return the index of the best start
+ */
+int simanneal::MultiStart::Run()
+{
+   std::vector<int> active(starts.size());
+   std::vector<int> finished(starts.size(), 0);
+
+   for(unsigned int i=0;i<active.size();i++)
+      active[i] = i;
+
+   int stage = 0;
+
+   while(!active.empty())
+   {
+      const int nr_workers = std::min<int>(threads, active.size());
+      std::atomic<unsigned int> next(0);
+
+      auto worker = [&] () {
+#ifdef _OPENMP
+         // divide the cores over the starts
+         omp_set_num_threads(std::max(1, threads / nr_workers));
+#endif
+         unsigned int i;
+
+         while((i = next++) < active.size())
+         {
+            const int s = active[i];
+
+            starts[s]->set_max_steps(stage_steps);
+            starts[s]->Minimize(false, stage*stage_steps);
+
+            energies[s] = starts[s]->get_energy();
+            finished[s] = starts[s]->Converged();
+         }
+      };
+
+      std::vector<std::thread> pool;
+      for(int t=0;t<nr_workers;t++)
+         pool.emplace_back(worker);
+
+      for(auto &t: pool)
+         t.join();
+
+      std::sort(active.begin(), active.end(), [this](int a, int b) { return energies[a] < energies[b]; });
+
+      std::cout << "Stage " << stage << ":" << std::endl;
+      for(auto s: active)
+         std::cout << "Start " << s << "\t" << energies[s] << (finished[s] ? "\tconverged" : "") << std::endl;
+
+      active.erase(std::remove_if(active.begin(), active.end(), [&finished](int s) { return finished[s]; }), active.end());
+
+      const unsigned int keep = std::max(1, int(std::ceil(keep_fraction * active.size())));
+
+      if(active.size() > keep)
+      {
+         std::cout << "Pruning " << active.size() - keep << " starts" << std::endl;
+         active.resize(keep);
+      }
+
+      if(stopping_min)
+         break;
+
+      stage++;
+   }
+
+   best = std::min_element(energies.begin(), energies.end()) - energies.begin();
+
+   std::cout << "Best start is " << best << " with " << energies[best] << std::endl;
+
+   return best;
+}
+
+/**
+ * @return the lowest energy (with the nuclear repulsion)
+ */
+double simanneal::MultiStart::get_energy() const
+{
+   return energies[best];
+}
+
+/**
+ * @return the local minimizer of the start with the lowest energy
+ */
+simanneal::LocalMinimizer& simanneal::MultiStart::getBest() const
+{
+   return *starts[best];
+}
+
+/**
+ * @param threads the number of starts to run at the same time
+ */
+void simanneal::MultiStart::set_threads(int threads)
+{
+   this->threads = std::max(1, threads);
+}
+
+/**
+ * @param steps the number of orbital steps between two prunings
+ */
+void simanneal::MultiStart::set_stage_steps(int steps)
+{
+   stage_steps = steps;
+}
+
+/**
+ * @param fraction the fraction of the unconverged starts to keep after every stage
+ */
+void simanneal::MultiStart::set_keep_fraction(double fraction)
+{
+   keep_fraction = fraction;
+}
+
+/*  vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,415 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <numeric>
+#include <algorithm>
+#include <signal.h>
+
+#include "OrbitalOptimizer.h"
+#include "OptIndex.h"
+#include "BoundaryPoint.h"
+#include "PotentialReducation.h"
+#include "OrbitalScan.h"
+
+// if set, the signal has been given to stop the minimalisation
+extern sig_atomic_t stopping_min;
+
+/**
+ * @param mol the molecular data to use
+ */
+simanneal::OrbitalOptimizer::OrbitalOptimizer(const CheMPS2::Hamiltonian &mol)
+{
+   ham.reset(new CheMPS2::Hamiltonian(mol));
+
+   init();
+}
+
+simanneal::OrbitalOptimizer::OrbitalOptimizer(CheMPS2::Hamiltonian &&mol)
+{
+   ham.reset(new CheMPS2::Hamiltonian(mol));
+
+   init();
+}
+
+simanneal::OrbitalOptimizer::~OrbitalOptimizer() = default;
+
+/**
+ * Set up the orbital transform, the method and the list of
+ * orbital pairs that can be rotated
+ */
+void simanneal::OrbitalOptimizer::init()
+{
+   orbtrans.reset(new OrbitalTransform(*ham));
+
+   method.reset(new doci2DM::BoundaryPoint(*ham));
+
+   energy = 0;
+
+   conv_crit = 1e-5;
+   max_iters = 200;
+   history = 8;
+   trust_radius = 0.5;
+
+   const OptIndex index(*ham);
+
+   // the offset of each irrep in the X vector: see UnitaryMatrix::build_skew_symm_x
+   std::vector<int> jump(index.getNirreps(), 0);
+   for(int irrep=1;irrep<index.getNirreps();irrep++)
+      jump[irrep] = jump[irrep-1] + index.getNORB(irrep-1)*(index.getNORB(irrep-1)-1)/2;
+
+   for(int k=0;k<ham->getL();k++)
+      for(int l=k+1;l<ham->getL();l++)
+         if(ham->getOrbitalIrrep(k) == ham->getOrbitalIrrep(l))
+         {
+            const int irrep = ham->getOrbitalIrrep(k);
+            const int k_loc = k - index.getNstart(irrep);
+            const int l_loc = l - index.getNstart(irrep);
+
+            pairs.push_back(std::make_pair(k,l));
+            x_index.push_back(jump[irrep] + k_loc + l_loc*(l_loc-1)/2);
+         }
+}
+
+/**
+ * @return the real energy (calculated + nuclear repulsion)
+ */
+double simanneal::OrbitalOptimizer::get_energy() const
+{
+   return energy + ham->getEconst();
+}
+
+/**
+ * Calculate the energy with the current unitary
+ * @return the new energy (without nuclear repulsion)
+ */
+double simanneal::OrbitalOptimizer::calc_new_energy()
+{
+   orbtrans->fillHamCI(*ham);
+
+   method->BuildHam(*ham);
+   method->Run();
+
+   return method->getEnergy();
+}
+
+simanneal::UnitaryMatrix& simanneal::OrbitalOptimizer::get_Optimal_Unitary()
+{
+   return orbtrans->get_unitary();
+}
+
+CheMPS2::Hamiltonian& simanneal::OrbitalOptimizer::getHam() const
+{
+   return *ham;
+}
+
+simanneal::OrbitalTransform& simanneal::OrbitalOptimizer::getOrbitalTf() const
+{
+   return *orbtrans;
+}
+
+doci2DM::Method& simanneal::OrbitalOptimizer::getMethod() const
+{
+   return *method;
+}
+
+/**
+ * Return a reference to a PotentialReduction object. Only works if the
+ * actual method is PotentialReduction. You should always wrap this in
+ * a try/catch block and check for a std::bad_cast exception
+ * @return PotentialReduction object of the current method
+ */
+doci2DM::PotentialReduction& simanneal::OrbitalOptimizer::getMethod_PR() const
+{
+   doci2DM::PotentialReduction &meth = dynamic_cast<doci2DM::PotentialReduction &> (*method);
+
+   return meth;
+}
+
+/**
+ * Return a reference to a BoundaryPoint object. Only works if the
+ * actual method is BoundaryPoint. You should always wrap this in
+ * a try/catch block and check for a std::bad_cast exception
+ * @return BoundaryPoint object of the current method
+ */
+doci2DM::BoundaryPoint& simanneal::OrbitalOptimizer::getMethod_BP() const
+{
+   doci2DM::BoundaryPoint &meth = dynamic_cast<doci2DM::BoundaryPoint &> (*method);
+
+   return meth;
+}
+
+void simanneal::OrbitalOptimizer::UseBoundaryPoint()
+{
+   method.reset(new doci2DM::BoundaryPoint(*ham));
+}
+
+void simanneal::OrbitalOptimizer::UsePotentialReduction()
+{
+   method.reset(new doci2DM::PotentialReduction(*ham));
+}
+
+/**
+ * The L-BFGS two-loop recursion, with the (absolute value of the) diagonal hessian
+ * as initial inverse hessian
+ * @param grad the current gradient
+ * @param hess the current diagonal hessian
+ * @return the search direction
+ */
+std::vector<double> simanneal::OrbitalOptimizer::lbfgs_direction(const std::vector<double> &grad, const std::vector<double> &hess) const
+{
+   // don't trust curvatures smaller than this
+   const double hess_floor = 1e-4;
+
+   const int m = s_hist.size();
+   std::vector<double> alpha(m);
+   std::vector<double> rho(m);
+   std::vector<double> dir(grad);
+
+   for(int i=m-1;i>=0;i--)
+   {
+      rho[i] = 1.0/std::inner_product(y_hist[i].begin(), y_hist[i].end(), s_hist[i].begin(), 0.0);
+      alpha[i] = rho[i] * std::inner_product(s_hist[i].begin(), s_hist[i].end(), dir.begin(), 0.0);
+
+      for(unsigned int j=0;j<dir.size();j++)
+         dir[j] -= alpha[i] * y_hist[i][j];
+   }
+
+   for(unsigned int j=0;j<dir.size();j++)
+      dir[j] /= std::max(fabs(hess[j]), hess_floor);
+
+   for(int i=0;i<m;i++)
+   {
+      const double beta = rho[i] * std::inner_product(y_hist[i].begin(), y_hist[i].end(), dir.begin(), 0.0);
+
+      for(unsigned int j=0;j<dir.size();j++)
+         dir[j] += (alpha[i] - beta) * s_hist[i][j];
+   }
+
+   for(auto &elem: dir)
+      elem *= -1;
+
+   return dir;
+}
+
+/**
+ * Minimize the energy to all orbital rotations at once with L-BFGS steps. A step
+ * that raises the energy is undone and the trust radius is shrunk.
+ * @param start_iters start number the iterations from this number (defaults to 0)
+ * @return the number of SDP solves
+ */
+int simanneal::OrbitalOptimizer::Minimize(int start_iters)
+{
+   // first run
+   energy = calc_new_energy();
+
+   auto start = std::chrono::high_resolution_clock::now();
+
+   const int npairs = pairs.size();
+   double radius = trust_radius;
+
+   std::vector<double> grad, hess;
+   std::vector<double> prev_grad, step;
+   std::vector<double> X(orbtrans->get_unitary().getNumVariablesX());
+
+   s_hist.clear();
+   y_hist.clear();
+
+   int iters = 1;
+
+   while(iters <= max_iters)
+   {
+      {
+         const doci2DM::DociIntegrals ints(*ham);
+         const doci2DM::OrbitalScan scanner(method->getRDM(), ints);
+
+         scanner.gradient(pairs, grad, hess);
+      }
+
+      if(!step.empty())
+      {
+         std::vector<double> y(npairs);
+         for(int i=0;i<npairs;i++)
+            y[i] = grad[i] - prev_grad[i];
+
+         // only keep the pair if the curvature condition holds
+         if(std::inner_product(y.begin(), y.end(), step.begin(), 0.0) > 1e-12)
+         {
+            s_hist.push_back(step);
+            y_hist.push_back(y);
+
+            if(s_hist.size() > history)
+            {
+               s_hist.erase(s_hist.begin());
+               y_hist.erase(y_hist.begin());
+            }
+         }
+      }
+
+      double max_grad = 0;
+      for(auto &elem: grad)
+         max_grad = std::max(max_grad, fabs(elem));
+
+      if(max_grad < conv_crit)
+      {
+         std::cout << "Orbital gradient converged: " << max_grad << std::endl;
+         break;
+      }
+
+      auto dir = lbfgs_direction(grad, hess);
+
+      // no descent direction: forget the history
+      if(std::inner_product(dir.begin(), dir.end(), grad.begin(), 0.0) >= 0)
+      {
+         s_hist.clear();
+         y_hist.clear();
+         dir = lbfgs_direction(grad, hess);
+      }
+
+      double norm = std::sqrt(std::inner_product(dir.begin(), dir.end(), dir.begin(), 0.0));
+
+      if(norm > radius)
+      {
+         for(auto &elem: dir)
+            elem *= radius/norm;
+
+         norm = radius;
+      }
+
+      // the energy change of the diagonal quadratic model
+      double predicted = 0;
+      for(int i=0;i<npairs;i++)
+         predicted += grad[i]*dir[i] + 0.5*hess[i]*dir[i]*dir[i];
+
+      // a jacobi rotation of (k,l) over theta is exp(X) with X(k,l) = -theta
+      std::fill(X.begin(), X.end(), 0);
+      for(int i=0;i<npairs;i++)
+         X[x_index[i]] = -1*dir[i];
+
+      UnitaryMatrix prev_unitary(orbtrans->get_unitary());
+      std::unique_ptr<doci2DM::Method> prev_method(method->Clone());
+
+      orbtrans->update_unitary(X.data());
+
+      const double new_energy = calc_new_energy();
+
+      std::cout << iters << "\t|g| = " << max_grad << "\t|step| = " << norm << "\tE_pred = " << energy+predicted+ham->getEconst() << "  E = " << new_energy+ham->getEconst() << "\t" << new_energy-energy << std::endl;
+
+      if(new_energy > energy)
+      {
+         std::cout << "Step went up, rejected" << std::endl;
+
+         orbtrans->get_unitary() = prev_unitary;
+         orbtrans->fillHamCI(*ham);
+         method = std::move(prev_method);
+
+         radius = 0.25*norm;
+         s_hist.clear();
+         y_hist.clear();
+         step.clear();
+
+         iters++;
+
+         if(radius < 1e-8)
+         {
+            std::cout << "Trust radius too small, quiting..." << std::endl;
+            break;
+         }
+
+         continue;
+      }
+
+      const double ratio = (new_energy-energy)/predicted;
+
+      if(ratio > 0.75 && norm > 0.99*radius)
+         radius = std::min(2*radius, trust_radius);
+      else if(ratio < 0.25)
+         radius *= 0.5;
+
+      prev_grad = grad;
+      step = dir;
+
+      std::stringstream h5_name;
+      h5_name << getenv("SAVE_H5_PATH") << "/unitary-" << start_iters+iters << ".h5";
+      orbtrans->get_unitary().saveU(h5_name.str());
+
+      h5_name.str("");
+      h5_name << getenv("SAVE_H5_PATH") << "/rdm-" << start_iters+iters << ".h5";
+      method->getRDM().WriteToFile(h5_name.str());
+
+      energy = new_energy;
+
+      iters++;
+
+      if(stopping_min)
+         break;
+   }
+
+   auto end = std::chrono::high_resolution_clock::now();
+
+   std::cout << "Orbital optimization took: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s (" << iters << " SDP solves)" << std::endl;
+
+   std::stringstream h5_name;
+   h5_name << getenv("SAVE_H5_PATH") << "/optimale-uni.h5";
+   get_Optimal_Unitary().saveU(h5_name.str());
+
+   return iters;
+}
+
+double simanneal::OrbitalOptimizer::get_conv_crit() const
+{
+   return conv_crit;
+}
+
+/**
+ * @param crit stop when all components of the orbital gradient are smaller than this
+ */
+void simanneal::OrbitalOptimizer::set_conv_crit(double crit)
+{
+   conv_crit = crit;
+}
+
+void simanneal::OrbitalOptimizer::set_max_iters(int iters)
+{
+   max_iters = iters;
+}
+
+/**
+ * @param hist the number of previous steps to use in the L-BFGS update
+ */
+void simanneal::OrbitalOptimizer::set_history(int hist)
+{
+   history = hist;
+}
+
+/**
+ * @param radius the largest allowed norm of a step in the rotation angles
+ */
+void simanneal::OrbitalOptimizer::set_trust_radius(double radius)
+{
+   trust_radius = radius;
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,334 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+
+#include <iostream>
+#include <cmath>
+#include <cassert>
+
+#include "OrbitalScan.h"
+#include "TPM.h"
+#include "DociIntegrals.h"
+
+using doci2DM::OrbitalScan;
+
+/**
+ * Contract the rdm and the integrals for all orbital pairs
+ * @param rdm_in the rdm to use
+ * @param ints_in the integrals to use (with the k/l slices)
+ */
+OrbitalScan::OrbitalScan(const TPM &rdm_in, const DociIntegrals &ints_in): rdm(rdm_in), ints(ints_in)
+{
+   L = rdm.gL();
+   c = 2.0/(rdm.gN()-1.0);
+
+   assert(ints.gL() == L);
+
+   B.resize(L*L);
+   V2.resize(L*L);
+   Y.resize(L*L);
+
+   for(int a=0;a<L;a++)
+      for(int b=0;b<L;b++)
+      {
+         B[a*L+b] = rdm(a,a+L,b,b+L);
+         V2[a*L+b] = rdm(a,b,a,b);
+         Y[a*L+b] = 2*ints.Vabab(a,b)-ints.Vabba(a,b);
+      }
+
+   rV.assign(L, 0);
+   U.assign(L, 0);
+   rowS.assign(L, 0);
+   D = 0;
+   Stot = 0;
+
+   for(int a=0;a<L;a++)
+   {
+      D += c*ints.T(a,a)*B[a*L+a];
+
+      for(int b=0;b<L;b++)
+      {
+         rV[a] += V2[a*L+b];
+         U[b] += c*ints.T(a,a)*V2[a*L+b];
+         rowS[a] += S(a,b);
+      }
+
+      Stot += rowS[a];
+   }
+
+   F.resize(L*L);
+
+#pragma omp parallel for
+   for(int p=0;p<L;p++)
+      for(int q=0;q<L;q++)
+      {
+         double res = 0;
+
+         for(int a=0;a<L;a++)
+            res += ints.Vaabb(p,a)*B[q*L+a] + Y[p*L+a]*V2[q*L+a];
+
+         F[p*L+q] = 2*res + 2*c*ints.T(p,p)*rV[q];
+      }
+}
+
+/**
+ * The contribution of orbital a to the sums over the orbitals
+ */
+inline double OrbitalScan::f(int p, int q, int a) const
+{
+   return 2*ints.Vaabb(p,a)*B[q*L+a] + 2*(Y[p*L+a]+c*ints.T(p,p))*V2[q*L+a];
+}
+
+/**
+ * The energy of the pair a,b when neither is rotated
+ */
+inline double OrbitalScan::S(int a, int b) const
+{
+   return c*(ints.T(a,a)+ints.T(b,b))*V2[a*L+b] + ints.Vaabb(a,b)*B[a*L+b] + Y[a*L+b]*V2[a*L+b];
+}
+
+/**
+ * Calculate the coefficients of the energy after a rotation of orbitals k and l.
+ * This gives the same results as TPM::calc_rotate, but all the sums over the
+ * orbitals (except the one with the k/l slices) are taken from the contractions.
+ * @param k the first orbital
+ * @param l the second orbital
+ * @return the coefficients
+ */
+OrbitalScan::Coefs OrbitalScan::coefficients(int k, int l) const
+{
+   std::vector<double> slice(3*L);
+
+   return coefficients(k, l, slice.data());
+}
+
+/**
+ * Same as above, but with the scratch space given by the caller
+ * @param k the first orbital
+ * @param l the second orbital
+ * @param slice scratch array of 3L doubles for the k/l slices of the integrals
+ * @return the coefficients
+ */
+OrbitalScan::Coefs OrbitalScan::coefficients(int k, int l, double *slice) const
+{
+   assert(k!=l);
+
+   ints.get_slice(k, l, slice);
+
+   const double *Vklaa = slice;
+   const double *Vkala = slice + L;
+   const double *Vkaal = slice + 2*L;
+
+   const double Bkk = B[k*L+k];
+   const double Bll = B[l*L+l];
+   const double Bkl = B[k*L+l];
+   const double V2kl = V2[k*L+l];
+
+   Coefs coef;
+
+   coef.constant = 2*c*(ints.T(k,k)+ints.T(l,l))*V2kl;
+   coef.constant += D - c*ints.T(k,k)*Bkk - c*ints.T(l,l)*Bll;
+   coef.constant += 2*(U[k] - c*ints.T(k,k)*V2[k*L+k] - c*ints.T(l,l)*V2[l*L+k]);
+   coef.constant += 2*(U[l] - c*ints.T(k,k)*V2[k*L+l] - c*ints.T(l,l)*V2[l*L+l]);
+   coef.constant += Stot - 2*rowS[k] - 2*rowS[l] + S(k,k) + S(l,l) + 2*S(k,l);
+
+   coef.cos2 = c*(ints.T(k,k)*Bkk+ints.T(l,l)*Bll);
+   coef.cos2 += F[k*L+k] - f(k,k,k) - f(k,k,l) + F[l*L+l] - f(l,l,k) - f(l,l,l);
+
+   coef.sin2 = c*(ints.T(l,l)*Bkk+ints.T(k,k)*Bll);
+   coef.sin2 += F[k*L+l] + F[l*L+k] - f(k,l,k) - f(k,l,l) - f(l,k,k) - f(l,k,l);
+
+   // 2sincos actually
+   coef.sincos = c*ints.T(k,l)*(Bll-Bkk);
+   coef.sincos += 2*c*ints.T(k,l)*((rV[l]-V2[l*L+k]-V2[l*L+l]) - (rV[k]-V2[k*L+k]-V2[k*L+l]));
+
+   for(int a=0;a<L;a++)
+   {
+      if(a==k || a==l)
+         continue;
+
+      coef.sincos += 2*Vklaa[a]*(B[l*L+a]-B[k*L+a])+2*(2*Vkala[a]-Vkaal[a])*(V2[l*L+a]-V2[k*L+a]);
+   }
+
+   coef.cos4 = ints.Vaabb(k,k)*Bkk+ints.Vaabb(l,l)*Bll+2*ints.Vaabb(k,l)*Bkl+2*(2*ints.Vabab(k,l)-ints.Vaabb(k,l))*V2kl;
+
+   coef.sin4 = ints.Vaabb(k,k)*Bll+ints.Vaabb(l,l)*Bkk+2*ints.Vaabb(k,l)*Bkl+2*(2*ints.Vabab(k,l)-ints.Vaabb(k,l))*V2kl;
+
+   // 2 x
+   coef.cos2sin2 = (2*ints.Vaabb(k,l)+ints.Vabab(k,l))*(Bkk+Bll)+((ints.Vaabb(k,k)+ints.Vaabb(l,l)-2*(ints.Vabab(k,l)+ints.Vaabb(k,l))))*Bkl+(ints.Vaabb(k,k)+ints.Vaabb(l,l)-6*ints.Vaabb(k,l)+2*ints.Vabab(k,l))*V2kl;
+
+   // 4 x
+   coef.sin3cos = Vklaa[k]*Bll-Vklaa[l]*Bkk-(Vklaa[k]-Vklaa[l])*(Bkl+V2kl);
+
+   // 4 x
+   coef.cos3sin = Vklaa[l]*Bll-Vklaa[k]*Bkk+(Vklaa[k]-Vklaa[l])*(Bkl+V2kl);
+
+   return coef;
+}
+
+/**
+ * @param coef the coefficients of the pair
+ * @param theta the angle to rotate over
+ * @return the energy after the rotation
+ */
+double OrbitalScan::energy(const Coefs &coef, double theta) const
+{
+   const double cos = std::cos(theta);
+   const double sin = std::sin(theta);
+
+   return coef.constant + cos*cos*cos*cos*coef.cos4 + sin*sin*sin*sin*coef.sin4 + cos*cos*coef.cos2 + sin*sin*coef.sin2 + 2*sin*cos*coef.sincos + 2*cos*cos*sin*sin*coef.cos2sin2 + 4*cos*sin*sin*sin*coef.sin3cos + 4*cos*cos*cos*sin*coef.cos3sin;
+}
+
+/**
+ * Find the minimum with Newton-Raphson for the angle of the rotation, in the same way as TPM::find_min_angle
+ * @param coef the coefficients of the pair
+ * @param start_angle the starting point for the Newton-Raphson
+ * @return pair of the angle with the lowest energy and boolean, true => minimum, false => maximum
+ */
+std::pair<double,bool> OrbitalScan::find_min_angle(const Coefs &coef, double start_angle) const
+{
+   double theta = start_angle;
+
+   auto gradient = [&coef] (double theta) -> double { 
+      double cos = std::cos(theta);
+      double sin = std::sin(theta);
+
+      return 16*(coef.cos3sin-coef.sin3cos)*cos*cos*cos*cos - 4*(coef.cos4+coef.sin4-2*coef.cos2sin2)*sin*cos*cos*cos + 4*(coef.sincos-3*coef.cos3sin+5*coef.sin3cos)*cos*cos + 2*(2*coef.sin4-coef.cos2+coef.sin2-2*coef.cos2sin2)*sin*cos-2*coef.sincos-4*coef.sin3cos;
+   };
+
+   auto hessian = [&coef] (double theta) -> double { 
+      double cos = std::cos(theta);
+      double sin = std::sin(theta);
+
+      return -16*(coef.cos4+coef.sin4-2*coef.cos2sin2)*cos*cos*cos*cos+64*(coef.sin3cos-coef.cos3sin)*sin*cos*cos*cos+4*(3*coef.cos4+5*coef.sin4-coef.cos2+coef.sin2-8*coef.cos2sin2)*cos*cos-8*(coef.sincos-3*coef.cos3sin+5*coef.sin3cos)*sin*cos+2*(coef.cos2-2*coef.sin4-coef.sin2+2*coef.cos2sin2);
+   };
+
+   const int max_iters = 20;
+   const double convergence = 1e-12;
+
+   double change = gradient(theta)*theta+hessian(theta)*theta*theta/2.0;
+
+   // if it goes uphill, try flipping sign and try again
+   if(change>0)
+      theta *= -1;
+
+   for(int iter=0;iter<max_iters;iter++)
+   {
+      double dx = gradient(theta)/hessian(theta);
+
+      theta -= dx;
+
+      if(fabs(dx) < convergence)
+         break;
+   }
+
+   return std::make_pair(theta, hessian(theta)>0);
+}
+
+/**
+ * Find the optimal rotation for all the pairs, in parallel.
+ * @param pairs the orbital pairs (k,l) to scan
+ * @param screening skip the pairs with an exchange integral |V(k,l,l,k)| smaller than this
+ * @return list of (k,l,theta,energy) for all the pairs where a minimum was found with |theta| <= Pi/2
+ */
+std::vector< std::tuple<int,int,double,double> > OrbitalScan::scan(const std::vector< std::pair<int,int> > &pairs, double screening) const
+{
+   const int npairs = pairs.size();
+
+   std::vector< std::tuple<int,int,double,double> > result(npairs);
+   // not a vector<bool>: the threads write to it
+   std::vector<char> keep(npairs, 0);
+
+#pragma omp parallel
+   {
+      // the k/l slices of the integrals, one per thread
+      std::vector<double> slice(3*L);
+
+#pragma omp for schedule(dynamic,16)
+      for(int i=0;i<npairs;i++)
+      {
+         const int k = pairs[i].first;
+         const int l = pairs[i].second;
+
+         if(fabs(ints.Vabba(k,l)) < screening)
+            continue;
+
+         const auto coef = coefficients(k,l,slice.data());
+
+         auto found = find_min_angle(coef,0.3);
+
+         if(!found.second)
+            // we hit a maximum
+            found = find_min_angle(coef,0.01);
+
+         // we're still stuck in a maximum or the angle is larger than Pi/2: skip this!
+         if(!found.second || fabs(found.first)>M_PI/2.0)
+            continue;
+
+         result[i] = std::make_tuple(k,l,found.first,energy(coef,found.first));
+         keep[i] = 1;
+      }
+   }
+
+   std::vector< std::tuple<int,int,double,double> > pos_rotations;
+   pos_rotations.reserve(npairs);
+
+   for(int i=0;i<npairs;i++)
+      if(keep[i])
+         pos_rotations.push_back(result[i]);
+
+   return pos_rotations;
+}
+
+/**
+ * The first and second derivative of the energy to the angle of the jacobi rotation of every pair,
+ * at theta = 0. Together this is the orbital gradient and the diagonal of the orbital hessian
+ * for the current orbitals.
+ * @param pairs the orbital pairs (k,l)
+ * @param grad will contain dE/dtheta for every pair
+ * @param hess will contain d^2E/dtheta^2 for every pair
+ */
+void OrbitalScan::gradient(const std::vector< std::pair<int,int> > &pairs, std::vector<double> &grad, std::vector<double> &hess) const
+{
+   const int npairs = pairs.size();
+
+   grad.resize(npairs);
+   hess.resize(npairs);
+
+#pragma omp parallel
+   {
+      // the k/l slices of the integrals, one per thread
+      std::vector<double> slice(3*L);
+
+#pragma omp for schedule(dynamic,16)
+      for(int i=0;i<npairs;i++)
+      {
+         const auto coef = coefficients(pairs[i].first,pairs[i].second,slice.data());
+
+         grad[i] = 2*coef.sincos + 4*coef.cos3sin;
+         hess[i] = -4*coef.cos4 - 2*coef.cos2 + 2*coef.sin2 + 4*coef.cos2sin2;
+      }
+   }
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -22,8 +22,11 @@
  */
 
 #include <assert.h>
+#include <algorithm>
+#include <cmath>
 
 #include "include.h"
+#include "LinComb.h"
 
 using namespace doci2DM;
 
@@ -37,7 +40,7 @@ std::unique_ptr<helpers::tmatrix<int>> PHM::b2s = nullptr;
  * @param L the number of levels
  * @param N the number of particles
  */
-PHM::PHM(int L, int N): BlockMatrix(1+(L*(L-1))/2)
+PHM::PHM(int L, int N)
 {
    this->L = L;
    this->N = N;
@@ -46,11 +49,180 @@ PHM::PHM(int L, int N): BlockMatrix(1+(L*(L-1))/2)
       constr_lists(L);
 
    // one LxL block
-   setDim(0, L, 1);
+   block.reset(new Matrix(L));
 
    // all the rest are 2x2 blocks
-   for(int i=1;i<gnr();i++)
-      setDim(i, 2, 1);
+   n2x2 = (L*(L-1))/2;
+
+   blk_a.resize(n2x2);
+   blk_c.resize(n2x2);
+   blk_d.resize(n2x2);
+}
+
+PHM::PHM(const PHM &orig)
+{
+   L = orig.L;
+   N = orig.N;
+   n2x2 = orig.n2x2;
+
+   block.reset(new Matrix(*orig.block));
+
+   blk_a = orig.blk_a;
+   blk_c = orig.blk_c;
+   blk_d = orig.blk_d;
+}
+
+PHM& PHM::operator=(const PHM &orig)
+{
+   L = orig.L;
+   N = orig.N;
+   n2x2 = orig.n2x2;
+
+   if(block && block->gn() == orig.block->gn())
+      (*block) = *orig.block;
+   else
+      block.reset(new Matrix(*orig.block));
+
+   blk_a = orig.blk_a;
+   blk_c = orig.blk_c;
+   blk_d = orig.blk_d;
+
+   return *this;
+}
+
+PHM& PHM::operator=(double a)
+{
+   (*block) = a;
+
+   std::fill(blk_a.begin(), blk_a.end(), a);
+   std::fill(blk_c.begin(), blk_c.end(), a);
+   std::fill(blk_d.begin(), blk_d.end(), a);
+
+   return *this;
+}
+
+PHM& PHM::operator+=(const PHM &phm)
+{
+   (*block) += *phm.block;
+
+#pragma omp simd
+   for(int i=0;i<n2x2;i++)
+   {
+      blk_a[i] += phm.blk_a[i];
+      blk_c[i] += phm.blk_c[i];
+      blk_d[i] += phm.blk_d[i];
+   }
+
+   return *this;
+}
+
+PHM& PHM::operator-=(const PHM &phm)
+{
+   (*block) -= *phm.block;
+
+#pragma omp simd
+   for(int i=0;i<n2x2;i++)
+   {
+      blk_a[i] -= phm.blk_a[i];
+      blk_c[i] -= phm.blk_c[i];
+      blk_d[i] -= phm.blk_d[i];
+   }
+
+   return *this;
+}
+
+/**
+ * add alpha times phm to this
+ * @param alpha the scaling factor
+ * @param phm the PHM to add
+ */
+PHM& PHM::daxpy(double alpha, const PHM &phm)
+{
+   block->daxpy(alpha, *phm.block);
+
+#pragma omp simd
+   for(int i=0;i<n2x2;i++)
+   {
+      blk_a[i] += alpha * phm.blk_a[i];
+      blk_c[i] += alpha * phm.blk_c[i];
+      blk_d[i] += alpha * phm.blk_d[i];
+   }
+
+   return *this;
+}
+
+PHM& PHM::operator*=(double alpha)
+{
+   dscal(alpha);
+
+   return *this;
+}
+
+PHM& PHM::operator/=(double alpha)
+{
+   dscal(1.0/alpha);
+
+   return *this;
+}
+
+/**
+ * Scale the PHM with alpha
+ * @param alpha the scaling factor
+ */
+void PHM::dscal(double alpha)
+{
+   block->dscal(alpha);
+
+#pragma omp simd
+   for(int i=0;i<n2x2;i++)
+   {
+      blk_a[i] *= alpha;
+      blk_c[i] *= alpha;
+      blk_d[i] *= alpha;
+   }
+}
+
+/**
+ * Set this object to the unit matrix
+ */
+void PHM::unit()
+{
+   block->unit();
+
+   std::fill(blk_a.begin(), blk_a.end(), 1.0);
+   std::fill(blk_c.begin(), blk_c.end(), 0.0);
+   std::fill(blk_d.begin(), blk_d.end(), 1.0);
+}
+
+/**
+ * @return the trace of the full G matrix
+ */
+double PHM::trace() const
+{
+   double res = block->trace();
+
+#pragma omp simd reduction(+:res)
+   for(int i=0;i<n2x2;i++)
+      res += blk_a[i] + blk_d[i];
+
+   return res;
+}
+
+/**
+ * @param phm the other PHM
+ * @return the inproduct Tr (this phm)
+ */
+double PHM::ddot(const PHM &phm) const
+{
+   double res = 0;
+
+#pragma omp simd reduction(+:res)
+   for(int i=0;i<n2x2;i++)
+      res += blk_a[i]*phm.blk_a[i] + 2*blk_c[i]*phm.blk_c[i] + blk_d[i]*phm.blk_d[i];
+
+   res += block->ddot(*phm.block);
+
+   return res;
 }
 
 void PHM::constr_lists(int L)
@@ -99,11 +271,11 @@ void PHM::constr_lists(int L)
    s2b.reset(new helpers::tmatrix<int>(L,L));
    (*s2b) = -1; // if you use something you shouldn't, this will case havoc
 
-   b2s.reset(new helpers::tmatrix<int>((L*(L-1))/2+1,2));
+   b2s.reset(new helpers::tmatrix<int>((L*(L-1))/2,2));
    (*b2s) = -1; // if you use something you shouldn't, this will case havoc
 
    // sp index to block index
-   tel = 1;
+   tel = 0;
    for(int a=0;a<L;a++)
       for(int b=a+1;b<L;b++)
       {
@@ -134,19 +306,18 @@ double PHM::operator()(int a, int b, int c, int d) const
       if(a!=b)
       {
          int i = (*s2b)(a,b);
-         int j = a > b ? 1 : 0;
-         return (*this)(i,j,j);
+         return a > b ? blk_d[i] : blk_a[i];
       } else
-         return (*this)(0,a,a);
+         return (*block)(a,a);
    };
 
    auto getrho = [this](int a, int b) {
       if(a!=b)
       {
          int i = (*s2b)(a,b);
-         return -1 * (*this)(i,0,1);
+         return -1 * blk_c[i];
       } else
-         return (*this)(0,a,a);
+         return (*block)(a,a);
    };
 
    // \bar a b ; \bar c d 
@@ -169,14 +340,14 @@ double PHM::operator()(int a, int b, int c, int d) const
             res += getelem(a%L,b%L);
 
          if(a==b && c==d && a!=c)
-            res += (*this)(0,a%L,c%L);
+            res += (*block)(a%L,c%L);
       } else
       {
          if(a%L==d%L && b%L==c%L)
             res += getrho(a%L,b%L);
 
          if(a==b && c==d && a%L!=c%L)
-            res += (*this)(0,a%L,c%L);
+            res += (*block)(a%L,c%L);
       }
    }
 
@@ -194,33 +365,58 @@ int PHM::gL() const
 }
 
 /**
- * Get a 2x2 block of the G matrix, corresponding with
- * indices a and b
- * @param a the first sp index
- * @param b the second sp index
- * @return the 2x2 matrix
+ * @return the number of storage blocks: the LxL block and the
+ * packed 2x2 blocks
  */
-const Matrix& PHM::getBlock(int a, int b) const
+int PHM::gnr() const
 {
-   const int idx = (*s2b)(a,b);
-   assert(idx>0);
+   return 2;
+}
+
+/**
+ * @return the number of 2x2 blocks
+ */
+int PHM::gn2x2() const
+{
+   return n2x2;
+}
 
-   return (*this)[idx];
+/**
+ * @return the LxL block
+ */
+const Matrix& PHM::getLxL() const
+{
+   return *block;
+}
+
+/**
+ * @return the LxL block
+ */
+Matrix& PHM::getLxL()
+{
+   return *block;
 }
 
 /**
- * Get a 2x2 block of the G matrix, corresponding with
+ * Get an element of the 2x2 block of the G matrix, corresponding with
  * indices a and b
  * @param a the first sp index
  * @param b the second sp index
- * @return the 2x2 matrix
+ * @param i the row in the 2x2 block
+ * @param j the column in the 2x2 block
+ * @return the matrix element
  */
-Matrix& PHM::getBlock(int a, int b)
+double PHM::get2x2(int a, int b, int i, int j) const
 {
    const int idx = (*s2b)(a,b);
-   assert(idx>0);
-
-   return (*this)[idx];
+   assert(idx>=0);
+
+   if(i != j)
+      return blk_c[idx];
+   else if(i == 0)
+      return blk_a[idx];
+   else
+      return blk_d[idx];
 }
 
 /**
@@ -235,22 +431,21 @@ void PHM::G(const TPM &tpm)
    for(int a=0;a<L;a++)
    {
       for(int b=a;b<L;b++)
-         (*this)(0,b,a) = (*this)(0,a,b) = tpm.getDiag(a,b);
+         (*block)(b,a) = (*block)(a,b) = tpm.getDiag(a,b);
 
-      (*this)(0,a,a) += spm(0,a);
+      (*block)(a,a) += spm(0,a);
    }
 
    // now all the 2x2 blocks
-   for(int i=1;i<gnr();i++)
-      {
-         auto& block = (*this)[i];
-         int a = (*b2s)(i,0);
-         int b = (*b2s)(i,1);
+   for(int i=0;i<n2x2;i++)
+   {
+      int a = (*b2s)(i,0);
+      int b = (*b2s)(i,1);
 
-         block(0,0) = spm(0,a) - tpm.getDiag(a,b);
-         block(1,1) = spm(0,b) - tpm.getDiag(a,b);
-         block(0,1) = block(1,0) = - tpm(a,a+L,b,b+L);
-      }
+      blk_a[i] = spm(0,a) - tpm.getDiag(a,b);
+      blk_d[i] = spm(0,b) - tpm.getDiag(a,b);
+      blk_c[i] = - tpm(a,a+L,b,b+L);
+   }
 }
 
 /**
@@ -315,19 +510,102 @@ Matrix PHM::Gbuild() const
    return Gmat;
 }
 
+/**
+ * Rotate this PHM object with a jacobi rotation between orbitals
+ * k and l over angle in the DOCI space: the full G matrix is rotated
+ * and projected back on the DOCI structure (in the same way as TPM::rotate_doci).
+ * @param k the first orbital
+ * @param l the second orbital
+ * @param angle the angle to rotate over
+ */
+void PHM::rotate(int k, int l, double angle)
+{
+   assert(k!=l);
+
+   const PHM old(*this);
+
+   const double cos = std::cos(angle);
+   const double sin = std::sin(angle);
+
+   // the new sp orbital p as linear combination of the old ones
+   auto expand = [&](int p, int *orbs, double *coefs) -> int {
+      const int spin = (p/L)*L;
+
+      if(p%L == k)
+      {
+         orbs[0] = k+spin; coefs[0] = cos;
+         orbs[1] = l+spin; coefs[1] = -sin;
+         return 2;
+      } else if(p%L == l)
+      {
+         orbs[0] = k+spin; coefs[0] = sin;
+         orbs[1] = l+spin; coefs[1] = cos;
+         return 2;
+      }
+
+      orbs[0] = p; coefs[0] = 1;
+      return 1;
+   };
+
+   auto rotated = [&](int a, int b, int c, int d) -> double {
+      int orbs[4][2];
+      double coefs[4][2];
+
+      const int na = expand(a, orbs[0], coefs[0]);
+      const int nb = expand(b, orbs[1], coefs[1]);
+      const int nc = expand(c, orbs[2], coefs[2]);
+      const int nd = expand(d, orbs[3], coefs[3]);
+
+      double res = 0;
+
+      for(int i=0;i<na;i++)
+         for(int j=0;j<nb;j++)
+            for(int m=0;m<nc;m++)
+               for(int n=0;n<nd;n++)
+                  res += coefs[0][i]*coefs[1][j]*coefs[2][m]*coefs[3][n] * old(orbs[0][i],orbs[1][j],orbs[2][m],orbs[3][n]);
+
+      return res;
+   };
+
+   // Every stored element appears in the full G matrix with equal and with opposite
+   // spins. After the rotation these can differ: take the average.
+
+   // the LxL block: only the rows and columns of k and l change
+   for(int a=0;a<L;a++)
+   {
+      (*block)(k,a) = (*block)(a,k) = 0.5 * (rotated(k,k,a,a) + rotated(k,k,a+L,a+L));
+      (*block)(l,a) = (*block)(a,l) = 0.5 * (rotated(l,l,a,a) + rotated(l,l,a+L,a+L));
+   }
+
+   // the 2x2 blocks with k or l
+   for(int i=0;i<n2x2;i++)
+   {
+      const int a = (*b2s)(i,0);
+      const int b = (*b2s)(i,1);
+
+      if(a != k && a != l && b != k && b != l)
+         continue;
+
+      blk_a[i] = 0.5 * (rotated(a,b,a,b) + rotated(a,b+L,a,b+L));
+      blk_d[i] = 0.5 * (rotated(b,a,b,a) + rotated(b,a+L,b,a+L));
+      blk_c[i] = 0.5 * (rotated(a,b+L,b,a+L) - rotated(a,b,b+L,a+L));
+   }
+}
+
 namespace doci2DM 
 {
    std::ostream &operator<<(std::ostream &output,doci2DM::PHM &phm)
    {
       output << "The LxL block: " << std::endl;
-      output << phm[0] << std::endl;
+      output << *phm.block << std::endl;
 
       output << std::endl;
 
-      for(int i=1;i<phm.gnr();i++)
+      for(int i=0;i<phm.n2x2;i++)
       {
-         output << "Block " << i-1 << " for " << (*phm.b2s)(i,0) << "\t" << (*phm.b2s)(i,1) << std::endl;
-         output << phm[i] << std::endl;
+         output << "Block " << i << " for " << (*phm.b2s)(i,0) << "\t" << (*phm.b2s)(i,1) << std::endl;
+         output << phm.blk_a[i] << "\t" << phm.blk_c[i] << std::endl;
+         output << phm.blk_c[i] << "\t" << phm.blk_d[i] << std::endl;
       }
 
       return output;
@@ -335,50 +613,174 @@ namespace doci2DM
 }
 
 /**
- * Use the 2x2 sep_pm for all the 2x2 blocks instead
- * of the full blown sep_pm
+ * Separate this matrix in a positive and negative part.
+ * The 2x2 blocks are done in closed form: the negative
+ * part is the negative eigenvalue times the projector on its
+ * eigenvector, (A - x2)/(x1 - x2).
  * @param pos the positive part of the matrix
  * @param neg the negative part of the matrix
  */
-void PHM::sep_pm(BlockMatrix &pos, BlockMatrix &neg)
+void PHM::sep_pm(PHM &pos, PHM &neg)
 {
-   (*this)[0].sep_pm(pos[0], neg[0]);
+   block->sep_pm(*pos.block, *neg.block);
+
+   const double *a = blk_a.data();
+   const double *c = blk_c.data();
+   const double *d = blk_d.data();
+
+   double *pa = pos.blk_a.data();
+   double *pc = pos.blk_c.data();
+   double *pd = pos.blk_d.data();
 
-#pragma omp parallel for if(gnr()>100)
-   for(int i=1;i<gnr();i++)
-      (*this)[i].sep_pm_2x2(pos[i], neg[i]);
+   double *na = neg.blk_a.data();
+   double *nc = neg.blk_c.data();
+   double *nd = neg.blk_d.data();
+
+#pragma omp simd
+   for(int i=0;i<n2x2;i++)
+   {
+      const double discr = std::sqrt((a[i]-d[i])*(a[i]-d[i]) + 4*c[i]*c[i]);
+
+      // the eigenvalues
+      const double x1 = 0.5*(a[i]+d[i] - discr);
+      const double x2 = 0.5*(a[i]+d[i] + discr);
+
+      // when x1 < 0 < x2, discr is never zero
+      const double fac = -x1/(discr > 0 ? discr : 1.0);
+
+      // both positive: neg = 0, both negative: neg = *this
+      const double n_a = x1 > 0 ? 0 : (x2 < 0 ? a[i] : fac*(a[i]-x2));
+      const double n_c = x1 > 0 ? 0 : (x2 < 0 ? c[i] : fac*c[i]);
+      const double n_d = x1 > 0 ? 0 : (x2 < 0 ? d[i] : fac*(d[i]-x2));
+
+      na[i] = n_a;
+      nc[i] = n_c;
+      nd[i] = n_d;
+
+      pa[i] = a[i] - n_a;
+      pc[i] = c[i] - n_c;
+      pd[i] = d[i] - n_d;
+   }
 }
 
 /**
  * Pull the sqrt out of this matrix.
- * Optimized for the structure of the 2x2 matrices
+ * The 2x2 blocks use the closed form sqrt(A) = (A + sqrt(det A))/sqrt(Tr A + 2 sqrt(det A))
  * @param option 1 => positive sqrt, -1 => negative sqrt
  */
 void PHM::sqrt(int option)
 {
-   (*this)[0].sqrt(option);
+   block->sqrt(option);
+
+   double *a = blk_a.data();
+   double *c = blk_c.data();
+   double *d = blk_d.data();
+
+#pragma omp simd
+   for(int i=0;i<n2x2;i++)
+   {
+      const double s = std::sqrt(a[i]*d[i]-c[i]*c[i]);
+      const double t = 1.0/std::sqrt(a[i]+d[i]+2*s);
+
+      const double sa = t*(a[i]+s);
+      const double sc = t*c[i];
+      const double sd = t*(d[i]+s);
 
-#pragma omp parallel for if(gnr()>100)
-   for(int i=1;i<gnr();i++)
-      (*this)[i].sqrt_2x2(option);
+      // the inverse of the sqrt: det(sqrt(A)) = s
+      const double fac = option == 1 ? 1.0 : 1.0/s;
+
+      a[i] = fac * (option == 1 ? sa : sd);
+      c[i] = fac * (option == 1 ? sc : -sc);
+      d[i] = fac * (option == 1 ? sd : sa);
+   }
 }
 
 void PHM::invert()
 {
-   (*this)[0].invert();
+   block->invert();
+
+   double *a = blk_a.data();
+   double *c = blk_c.data();
+   double *d = blk_d.data();
 
-#pragma omp parallel for if(gnr()>100)
-   for(int i=1;i<gnr();i++)
-      (*this)[i].invert_2x2();
+#pragma omp simd
+   for(int i=0;i<n2x2;i++)
+   {
+      const double fac = 1.0/(a[i]*d[i]-c[i]*c[i]);
+      const double tmp = a[i];
+
+      a[i] = fac * d[i];
+      c[i] *= -fac;
+      d[i] = fac * tmp;
+   }
 }
 
-void PHM::L_map(const BlockMatrix &map,const BlockMatrix &object)
+/**
+ * this = map*object*map
+ * @param map the map to use
+ * @param object the central matrix
+ */
+void PHM::L_map(const PHM &map, const PHM &object)
 {
-   (*this)[0].L_map(map[0], object[0]);
+   block->L_map(*map.block, *object.block);
+
+   const double *a1 = object.blk_a.data();
+   const double *c1 = object.blk_c.data();
+   const double *d1 = object.blk_d.data();
+
+   const double *a2 = map.blk_a.data();
+   const double *c2 = map.blk_c.data();
+   const double *d2 = map.blk_d.data();
+
+   double *a = blk_a.data();
+   double *c = blk_c.data();
+   double *d = blk_d.data();
 
-#pragma omp parallel for if(gnr()>100)
-   for(int i=1;i<gnr();i++)
-      (*this)[i].L_map_2x2(map[i], object[i]);
+#pragma omp simd
+   for(int i=0;i<n2x2;i++)
+   {
+      a[i] = a2[i]*(a1[i]*a2[i]+c1[i]*c2[i])+c2[i]*(a2[i]*c1[i]+c2[i]*d1[i]);
+      c[i] = a2[i]*(a1[i]*c2[i]+c1[i]*d2[i])+c2[i]*(c1[i]*c2[i]+d1[i]*d2[i]);
+      d[i] = c2[i]*(a1[i]*c2[i]+c1[i]*d2[i])+d2[i]*(c1[i]*c2[i]+d1[i]*d2[i]);
+   }
+}
+
+/**
+ * Calculate the eigenvalues of all the 2x2 blocks in closed form
+ * @param eigs Vector of size 2*gn2x2() to store the eigenvalues in
+ */
+void PHM::eigenvalues_2x2(Vector &eigs) const
+{
+   assert(eigs.gn() == 2*n2x2);
+
+   const double *a = blk_a.data();
+   const double *c = blk_c.data();
+   const double *d = blk_d.data();
+
+   double *x = eigs.gVector();
+
+#pragma omp simd
+   for(int i=0;i<n2x2;i++)
+   {
+      const double discr = std::sqrt((a[i]-d[i])*(a[i]-d[i]) + 4*c[i]*c[i]);
+
+      x[2*i] = 0.5*(a[i]+d[i] - discr);
+      x[2*i+1] = 0.5*(a[i]+d[i] + discr);
+   }
+}
+
+/**
+ * Add the memory of this PHM to the segment list
+ * @param seg the list to add to
+ */
+void PHM::segments(Segments &seg) const
+{
+   block->segments(seg);
+
+   // the storage itself is not const, only our view on it
+   seg.add(const_cast<double *>(blk_a.data()), n2x2);
+   seg.add(const_cast<double *>(blk_c.data()), n2x2);
+   seg.add(const_cast<double *>(blk_d.data()), n2x2);
 }
 
 /**
@@ -391,15 +793,13 @@ void PHM::WriteToFile(hid_t &group_id) const
    herr_t      status;
 
    // first the LxL block
-   hsize_t dimblock = (*this)[0].gn() * (*this)[0].gn();
+   hsize_t dimblock = L*L;
 
    dataspace_id = H5Screate_simple(1, &dimblock, NULL);
 
    dataset_id = H5Dcreate(group_id, "Block", H5T_IEEE_F64LE, dataspace_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
 
-   double *data = const_cast<Matrix &>((*this)[0]).gMatrix();
-
-   status = H5Dwrite(dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+   status = H5Dwrite(dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, block->gMatrix());
    HDF5_STATUS_CHECK(status);
 
    status = H5Dclose(dataset_id);
@@ -412,13 +812,14 @@ void PHM::WriteToFile(hid_t &group_id) const
    dimblock = 4;
    dataspace_id = H5Screate_simple(1, &dimblock, NULL);
 
-   for(int i=1;i<gnr();i++)
+   for(int i=0;i<n2x2;i++)
    {
-      std::string blockname = "2x2_" + std::to_string(i);
+      std::string blockname = "2x2_" + std::to_string(i+1);
 
       dataset_id = H5Dcreate(group_id, blockname.c_str(), H5T_IEEE_F64LE, dataspace_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
 
-      data = const_cast<Matrix &>((*this)[i]).gMatrix();
+      // column major 2x2 matrix, as before
+      double data[4] = {blk_a[i], blk_c[i], blk_c[i], blk_d[i]};
 
       status = H5Dwrite(dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
       HDF5_STATUS_CHECK(status);
@@ -504,22 +905,28 @@ void PHM::ReadFromFile(hid_t &group_id)
    dataset_id = H5Dopen(group_id, "Block", H5P_DEFAULT);
    HDF5_STATUS_CHECK(dataset_id);
 
-   status = H5Dread(dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, (*this)[0].gMatrix());
+   status = H5Dread(dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, block->gMatrix());
    HDF5_STATUS_CHECK(status);
 
    status = H5Dclose(dataset_id);
    HDF5_STATUS_CHECK(status);
 
-   for(int i=1;i<gnr();i++)
+   for(int i=0;i<n2x2;i++)
    {
-      std::string blockname = "2x2_" + std::to_string(i);
+      std::string blockname = "2x2_" + std::to_string(i+1);
 
       dataset_id = H5Dopen(group_id, blockname.c_str(), H5P_DEFAULT);
       HDF5_STATUS_CHECK(dataset_id);
 
-      status = H5Dread(dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, (*this)[i].gMatrix());
+      double data[4];
+
+      status = H5Dread(dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
       HDF5_STATUS_CHECK(status);
 
+      blk_a[i] = data[0];
+      blk_c[i] = data[1];
+      blk_d[i] = data[3];
+
       status = H5Dclose(dataset_id);
       HDF5_STATUS_CHECK(status);
    }
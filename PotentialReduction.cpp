@@ -24,7 +24,6 @@
 #include <fstream>
 #include <iomanip>
 #include <chrono>
-#include <functional>
 #include "PotentialReducation.h"
 #include "Hamiltonian.h"
 
@@ -135,10 +134,7 @@ PotentialReduction* PotentialReduction::Move()
  */
 void PotentialReduction::BuildHam(const CheMPS2::Hamiltonian &hamin)
 {
-   std::function<double(int,int)> getT = [&hamin] (int a, int b) -> double { return hamin.getTmat(a,b); };
-   std::function<double(int,int,int,int)> getV = [&hamin] (int a, int b, int c, int d) -> double { return hamin.getVmat(a,b,c,d); };
-
-   ham->ham(getT, getV);
+   ham->ham(DociIntegrals(hamin));
 
    norm_ham = std::sqrt(ham->ddot(*ham));
    (*ham) /= norm_ham;
@@ -67,13 +67,27 @@ SUP::SUP(SUP &&orig)
 
 SUP& SUP::operator=(const SUP &orig)
 {
-   I.reset(new TPM(*orig.I));
+   this->L = orig.L;
+   this->N = orig.N;
+
+   // copy in place when we still have our blocks
+   if(I)
+      (*I) = *orig.I;
+   else
+      I.reset(new TPM(*orig.I));
+
 #ifdef __Q_CON
-   Q.reset(new TPM(*orig.Q));
+   if(Q)
+      (*Q) = *orig.Q;
+   else
+      Q.reset(new TPM(*orig.Q));
 #endif
 
 #ifdef __G_CON
-   G.reset(new PHM(*orig.G));
+   if(G)
+      (*G) = *orig.G;
+   else
+      G.reset(new PHM(*orig.G));
 #endif
 
    return *this;
@@ -171,6 +185,22 @@ void SUP::dscal(double alpha)
 #endif
 }
 
+/**
+ * Set this object to the unit matrix
+ */
+void SUP::unit()
+{
+   I->unit();
+
+#ifdef __Q_CON
+   Q->unit();
+#endif
+
+#ifdef __G_CON
+   G->unit();
+#endif
+}
+
 int SUP::gN() const
 {
    return N;
@@ -224,6 +254,26 @@ void SUP::invert()
 #endif
 }
 
+/**
+ * Rotate all the blocks of this SUP with a jacobi rotation between orbitals
+ * k and l over angle in the DOCI space
+ * @param k the first orbital
+ * @param l the second orbital
+ * @param angle the angle to rotate over
+ */
+void SUP::rotate(int k, int l, double angle)
+{
+   I->rotate_doci(k,l,angle);
+
+#ifdef __Q_CON
+   Q->rotate_doci(k,l,angle);
+#endif
+
+#ifdef __G_CON
+   G->rotate(k,l,angle);
+#endif
+}
+
 /**
  * Fill the SUP object with the tpm object
  * @param tpm the TPM to use
@@ -346,17 +396,33 @@ void SUP::sep_pm(SUP &pos, SUP &neg)
 #endif
 }
 
+/**
+ * Add the memory of this SUP to the segment list
+ * @param seg the list to add to
+ */
+void SUP::segments(Segments &seg) const
+{
+   I->segments(seg);
+
+#ifdef __Q_CON
+   Q->segments(seg);
+#endif
+
+#ifdef __G_CON
+   G->segments(seg);
+#endif
+}
+
 /**
  * Initialization of the SUP matrix S, is just u^0: see primal_dual.pdf for more information
  */
 void SUP::init_S(const Lineq &lineq)
 {
-   *this = lineq.gu_0(0);
-
-   this->dscal(lineq.ge_ortho(0));
+   // sum_i e~_i u^0_i = fill(sum_i e~_i E~_i)
+   TPM tmp(L,N);
+   tmp.init(lineq);
 
-   for(int i = 1;i < lineq.gnr();++i)
-      this->daxpy(lineq.ge_ortho(i),lineq.gu_0(i));
+   fill(tmp);
 }
 
 /**
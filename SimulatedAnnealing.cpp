@@ -21,6 +21,7 @@
  * @END LICENSE
  */
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <fstream>
@@ -37,6 +38,8 @@
 #include "OptIndex.h"
 #include "BoundaryPoint.h"
 #include "PotentialReducation.h"
+#include "DociIntegrals.h"
+#include "OrbitalScan.h"
 
 /**
  * You still need to set the max_angle, delta_angle, start_temp and
@@ -61,12 +64,17 @@ simanneal::SimulatedAnnealing::SimulatedAnnealing(const CheMPS2::Hamiltonian &mo
    energy = 0;
    max_steps = 20000;
    unaccepted = 0;
+   screened = 0;
+   delayed_acceptance = false;
+   guided_proposals = false;
+   guided_mix = 0.1;
+   min_temp = 1e-5;
    stop_running = false;
 }
 
 simanneal::SimulatedAnnealing::SimulatedAnnealing(CheMPS2::Hamiltonian &&mol)
 {
-   ham.reset(new CheMPS2::Hamiltonian(mol));
+   ham.reset(new CheMPS2::Hamiltonian(std::move(mol)));
 
    OptIndex index(*ham);
 
@@ -82,6 +90,11 @@ simanneal::SimulatedAnnealing::SimulatedAnnealing(CheMPS2::Hamiltonian &&mol)
    energy = 0;
    max_steps = 20000;
    unaccepted = 0;
+   screened = 0;
+   delayed_acceptance = false;
+   guided_proposals = false;
+   guided_mix = 0.1;
+   min_temp = 1e-5;
    stop_running = false;
 }
 
@@ -115,6 +128,41 @@ void simanneal::SimulatedAnnealing::Set_delta_temp(double delta_temp)
    this->delta_temp = delta_temp;
 }
 
+/**
+ * @param min_temp the temperature of the coldest chain in optimize_pt()
+ */
+void simanneal::SimulatedAnnealing::Set_min_temp(double min_temp)
+{
+   this->min_temp = min_temp;
+}
+
+/**
+ * Screen every move with the energy change estimated from the current 2DM
+ * (delayed acceptance). Only the moves that pass this test are checked with
+ * the SDP. The second stage uses the Christen-Fox ratio, with the screening
+ * test of the reverse move estimated from the new 2DM, so the chain keeps the
+ * stationary distribution of the Metropolis test (this always uses the
+ * Metropolis test instead of accept_function()).
+ * @param delayed turn the delayed acceptance on or off
+ */
+void simanneal::SimulatedAnnealing::Set_delayed_acceptance(bool delayed)
+{
+   this->delayed_acceptance = delayed;
+}
+
+/**
+ * Draw the orbital pairs and the angles of the moves from the energy landscape
+ * of the current 2DM (see doci2DM::OrbitalScan) instead of uniformly. The moves
+ * are accepted with a Metropolis test that corrects for the ratio between the
+ * reverse and forward proposal probability. Together with the delayed acceptance,
+ * the ratio of the reverse and forward screening probabilities is included too.
+ * @param guided turn the guided proposals on or off
+ */
+void simanneal::SimulatedAnnealing::Set_guided_proposals(bool guided)
+{
+   this->guided_proposals = guided;
+}
+
 /**
  * Decide wether or not to accept the new energy
  * @param e_new the new energy
@@ -138,6 +186,21 @@ bool simanneal::SimulatedAnnealing::accept_function(double e_new)
    }
 }
 
+/**
+ * The Metropolis test
+ * @param diff the change in energy
+ * @return accept or not
+ */
+bool simanneal::SimulatedAnnealing::metropolis(double diff)
+{
+   std::uniform_real_distribution<double> dist_accept(0, 1);
+
+   if(diff < 0)
+      return true;
+
+   return dist_accept(mt) < std::exp(-diff / cur_temp);
+}
+
 /**
  * Calculate the energy with the current
  * molecular data
@@ -164,6 +227,93 @@ double simanneal::SimulatedAnnealing::calc_new_energy()
    return method->getEnergy();
 }
 
+/**
+ * Calculate the energy with the hamiltonian as it is now,
+ * without transforming it again from the unitary
+ * @param new_ham the integrals to use
+ */
+double simanneal::SimulatedAnnealing::calc_new_energy(const CheMPS2::Hamiltonian &new_ham)
+{
+   method->BuildHam(new_ham);
+   method->Run();
+
+   return method->getEnergy();
+}
+
+/**
+ * Rotate the orbitals k and l of the current hamiltonian and unitary
+ * over an angle and put the rotation in the undo journal.
+ * @param k the first orbital
+ * @param l the second orbital
+ * @param angle the angle of the jacobi rotation
+ */
+void simanneal::SimulatedAnnealing::rotate(int k, int l, double angle)
+{
+   const int irrep = ham->getOrbitalIrrep(k);
+
+   orbtrans->DoJacobiRotation(*ham, k, l, angle);
+   orbtrans->get_unitary().jacobi_rotation(irrep, k, l, angle);
+
+   journal.push_back(std::make_tuple(irrep, k, l, angle));
+}
+
+/**
+ * Undo all the rotations in the journal (last one first) by rotating
+ * back the hamiltonian and the unitary
+ */
+void simanneal::SimulatedAnnealing::undo()
+{
+   while(!journal.empty())
+   {
+      const auto &rot = journal.back();
+
+      orbtrans->DoJacobiRotation(*ham, std::get<1>(rot), std::get<2>(rot), -1*std::get<3>(rot));
+      orbtrans->get_unitary().jacobi_rotation(std::get<0>(rot), std::get<1>(rot), std::get<2>(rot), -1*std::get<3>(rot));
+
+      journal.pop_back();
+   }
+}
+
+/**
+ * The proposal distribution for the guided moves. Every pair gets a weight
+ * proportional to the energy it can gain with one rotation (as estimated with the scanner),
+ * mixed with a uniform distribution so every pair stays possible. The angle is drawn from a
+ * gaussian around the angle of the estimated minimum.
+ * @param scanner the scanner of the current 2DM and integrals
+ * @param pairs the orbital pairs that can be rotated
+ * @param weights will contain the probability of each pair
+ * @param centers will contain the estimated optimal angle of each pair
+ */
+void simanneal::SimulatedAnnealing::proposal_distribution(const doci2DM::OrbitalScan &scanner, const std::vector< std::pair<int,int> > &pairs, std::vector<double> &weights, std::vector<double> &centers) const
+{
+   const int npairs = pairs.size();
+
+   weights.assign(npairs, 0);
+   centers.assign(npairs, 0);
+
+   // only the pairs that have a minimum are returned, in the same order as pairs
+   const auto rots = scanner.scan(pairs);
+   const int nrots = rots.size();
+   const double e0 = scanner.energy(scanner.coefficients(pairs[0].first, pairs[0].second), 0);
+
+   double total_gain = 0;
+
+   for(int i=0, j=0;i<npairs && j<nrots;i++)
+      if(pairs[i].first == std::get<0>(rots[j]) && pairs[i].second == std::get<1>(rots[j]))
+      {
+         centers[i] = std::get<2>(rots[j]);
+         weights[i] = std::max(0.0, e0 - std::get<3>(rots[j]));
+         total_gain += weights[i];
+         j++;
+      }
+
+   for(int i=0;i<npairs;i++)
+      if(total_gain > 0)
+         weights[i] = guided_mix/npairs + (1-guided_mix)*weights[i]/total_gain;
+      else
+         weights[i] = 1.0/npairs;
+}
+
 /**
  * Do the simulated annealing
  */
@@ -203,10 +353,55 @@ void simanneal::SimulatedAnnealing::optimize()
 
    doci2DM::BoundaryPoint *bp_meth = dynamic_cast<doci2DM::BoundaryPoint *>(method.get());
 
+   // the integrals of the current orbitals, to screen the moves
+   std::unique_ptr<doci2DM::DociIntegrals> cur_ints;
+
+   // for the guided proposals
+   std::vector< std::pair<int,int> > pairs;
+   std::vector<double> weights, centers;
+   std::normal_distribution<double> dist_normal(0, 1);
+
+   for(int k=0;k<ham->getL();k++)
+      for(int l=k+1;l<ham->getL();l++)
+         if(ham->getOrbitalIrrep(k) == ham->getOrbitalIrrep(l))
+            pairs.push_back(std::make_pair(k,l));
+
+   if(pairs.empty())
+      guided_proposals = false;
+
+   // the hamiltonian is only updated with the rotations of the moves from here on,
+   // so it should belong to the current unitary (it changes after a MPI exchange)
+   orbtrans->fillHamCI(*ham);
+   journal.clear();
+
+   if(delayed_acceptance || guided_proposals)
+   {
+      // the 2DM should belong to the current unitary too
+      energy = calc_new_energy(*ham);
+      cur_ints.reset(new doci2DM::DociIntegrals(*ham));
+   }
+
+   if(guided_proposals)
+   {
+      const doci2DM::OrbitalScan scanner(method->getRDM(), *cur_ints);
+      proposal_distribution(scanner, pairs, weights, centers);
+   }
+
    for(unsigned int i=0;i<max_steps;i++)
    {
-      auto orb1 = dist(mt);
-      auto orb2 = dist(mt);
+      int orb1, orb2, cur_pair = 0;
+
+      if(guided_proposals)
+      {
+         cur_pair = std::discrete_distribution<int>(weights.begin(), weights.end())(mt);
+         orb1 = pairs[cur_pair].first;
+         orb2 = pairs[cur_pair].second;
+      }
+      else
+      {
+         orb1 = dist(mt);
+         orb2 = dist(mt);
+      }
 
       if(orb1 != orb2 && ham->getOrbitalIrrep(orb1) == ham->getOrbitalIrrep(orb2))
       {
@@ -216,29 +411,132 @@ void simanneal::SimulatedAnnealing::optimize()
          // between -1 and 1 but higher probablity to be close to zero (seems to work better)
          double cur_angle = max_angle * (dist_angles(mt) - dist_angles(mt));
 
+         // same spread as the uniform proposal
+         const double sigma = max_angle / std::sqrt(6.0);
+         // log of the forward proposal probability (up to a constant)
+         double log_forward = 0;
+
+         if(guided_proposals)
+         {
+            cur_angle = centers[cur_pair] + sigma * dist_normal(mt);
+            log_forward = std::log(weights[cur_pair]) - 0.5*(cur_angle-centers[cur_pair])*(cur_angle-centers[cur_pair])/(sigma*sigma);
+         }
+
          out << "P=" << rank << "\t" << i << "\tT=" << cur_temp << "\tOrb1=" << orb1 << "\tOrb2=" << orb2 << "  Over " << cur_angle << std::endl;
 
-         auto uni_copy = orbtrans->get_unitary();
-         orbtrans->get_unitary().jacobi_rotation(ham->getOrbitalIrrep(orb1), orb1, orb2, cur_angle);
+         // delayed acceptance: first a Metropolis test with the energy change estimated
+         // from the current 2DM, only the moves that pass get a SDP solve
+         double screen_diff = 0;
+         std::unique_ptr<doci2DM::TPM> prev_rdm;
+
+         if(delayed_acceptance)
+         {
+            const auto& rdm = method->getRDM();
+
+            screen_diff = rdm.calc_rotate(orb1, orb2, cur_angle, *cur_ints) - rdm.calc_rotate(orb1, orb2, 0, *cur_ints);
+
+            if(!metropolis(screen_diff))
+            {
+               unaccepted++;
+               screened++;
+               out << "P=" << rank << "\t" << i << "\tT=" << cur_temp << "\tEstimated change = " << screen_diff << "\t=> Screened out, " << screened << std::endl;
+
+               cur_temp *= delta_temp;
+               max_angle *= delta_angle;
+               continue;
+            }
+         }
+
+         if(delayed_acceptance || guided_proposals)
+            prev_rdm.reset(new doci2DM::TPM(method->getRDM()));
+
+         rotate(orb1, orb2, cur_angle);
 
-         auto new_energy = calc_new_energy();
+         // rotate the start point of the boundary point method into the new basis
+         std::unique_ptr<doci2DM::SUP> prev_X, prev_Z;
+
+         if(bp_meth)
+         {
+            prev_X.reset(new doci2DM::SUP(bp_meth->getX()));
+            prev_Z.reset(new doci2DM::SUP(bp_meth->getZ()));
+
+            bp_meth->rotate(orb1, orb2, cur_angle);
+         }
+
+         auto new_energy = calc_new_energy(*ham);
 
          if(new_energy < lowest_energy)
             lowest_energy = new_energy;
 
          out << "P=" << rank << "\t" << i << "\tT=" << cur_temp << "\tNew energy = " << new_energy + ham->getEconst() << "\t Old energy = " << get_energy();
 
-         if(accept_function(new_energy))
+         // log of the ratio of the reverse and the forward proposal (and screening)
+         // probability, the reverse move is taken from the new 2DM and integrals
+         std::unique_ptr<doci2DM::DociIntegrals> new_ints;
+         std::vector<double> new_weights, new_centers;
+         double log_ratio = 0;
+
+         if(delayed_acceptance || guided_proposals)
+            new_ints.reset(new doci2DM::DociIntegrals(*ham));
+
+         if(guided_proposals)
+         {
+            const doci2DM::OrbitalScan scanner(method->getRDM(), *new_ints);
+            proposal_distribution(scanner, pairs, new_weights, new_centers);
+
+            const double log_reverse = std::log(new_weights[cur_pair]) - 0.5*(cur_angle+new_centers[cur_pair])*(cur_angle+new_centers[cur_pair])/(sigma*sigma);
+
+            log_ratio = log_reverse - log_forward;
+         }
+
+         // second stage (Christen-Fox): multiply with the ratio of the screening
+         // probabilities min(1,exp(-est/T)) of the reverse and the forward move.
+         // The reverse move is estimated from the new 2DM and integrals.
+         if(delayed_acceptance)
+         {
+            const auto& rdm = method->getRDM();
+
+            const double rev_diff = rdm.calc_rotate(orb1, orb2, -cur_angle, *new_ints) - rdm.calc_rotate(orb1, orb2, 0, *new_ints);
+
+            log_ratio += std::min(0.0, -rev_diff/cur_temp) - std::min(0.0, -screen_diff/cur_temp);
+         }
+
+         bool accept;
+
+         if(delayed_acceptance || guided_proposals)
+            accept = metropolis(new_energy - energy - cur_temp * log_ratio);
+         else
+            accept = accept_function(new_energy);
+
+         if(accept)
          {
             energy = new_energy;
+            journal.clear();
             out << "\t=> Accepted" << std::endl;
+
+            if(delayed_acceptance || guided_proposals)
+               cur_ints = std::move(new_ints);
+
+            if(guided_proposals)
+            {
+               weights = std::move(new_weights);
+               centers = std::move(new_centers);
+            }
          }
          else
          {
             unaccepted++;
             out << "\t=> Unaccepted, " << unaccepted << std::endl;
-//            orbtrans->get_unitary().jacobi_rotation(ham->getOrbitalIrrep(orb1), orb1, orb2, -1*cur_angle);
-            orbtrans->get_unitary() = std::move(uni_copy);
+            undo();
+
+            if(bp_meth)
+            {
+               bp_meth->getX() = std::move(*prev_X);
+               bp_meth->getZ() = std::move(*prev_Z);
+            }
+
+            if(delayed_acceptance || guided_proposals)
+               method->getRDM() = *prev_rdm;
          }
 
          cur_temp *= delta_temp;
@@ -266,6 +564,8 @@ void simanneal::SimulatedAnnealing::optimize()
 
    if(bp_meth)
       out << "Accuracy down to " << bp_meth->get_tol_PD() << std::endl;
+   if(delayed_acceptance)
+      out << "Screened out " << screened << " moves without solving the SDP" << std::endl;
    out << "Bottom was " << lowest_energy + ham->getEconst() << std::endl;
    out << "Final energy = " << get_energy() << std::endl;
 
@@ -451,4 +751,166 @@ void simanneal::SimulatedAnnealing::optimize_mpi()
    MPI_Barrier(MPI_COMM_WORLD);
 }
 
+/**
+ * Parallel tempering (replica exchange): every rank runs a chain at a fixed
+ * temperature, from start_temp (highest rank) down to min_temp (rank 0) on a
+ * geometric ladder. After every segment of steps, neighbouring ranks try to swap
+ * their configurations (unitary and energy). Only the partners of a swap wait on each
+ * other. The ranks send a short report of every segment to rank 0, which prints them
+ * whenever it is between two segments itself. At the end, all ranks continue with the
+ * lowest configuration that was found.
+ * @param rounds the number of segments (and swap attempts)
+ * @param segment_steps the number of steps in a segment
+ */
+void simanneal::SimulatedAnnealing::optimize_pt(unsigned int rounds, unsigned int segment_steps)
+{
+   int size, rank;
+   MPI_Comm_size(MPI_COMM_WORLD, &size);
+   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+   std::stringstream out_name;
+   out_name << getenv("SAVE_H5_PATH") << "/output-" << rank << ".txt";
+   if(size > 1)
+      method->set_outfile(out_name.str());
+   std::ofstream myfile;
+   myfile.open(out_name.str(), std::ios::out | std::ios::trunc | std::ios::binary);
+   myfile.close();
+
+   // the temperature ladder, rank 0 is the coldest
+   const double max_temp = start_temp;
+   auto ladder = [this,size,max_temp] (int r) -> double {
+      return (size > 1) ? min_temp * std::pow(max_temp/min_temp, r*1.0/(size-1)) : min_temp;
+   };
+
+   const double my_temp = ladder(rank);
+
+   // fixed temperature per chain, smaller moves in the colder chains
+   start_temp = my_temp;
+   delta_temp = 1;
+   delta_angle = 1;
+   max_angle *= std::sqrt(my_temp / max_temp);
+   max_steps = segment_steps;
+
+   doci2DM::BoundaryPoint *bp_meth = dynamic_cast<doci2DM::BoundaryPoint *>(method.get());
+   if(bp_meth)
+   {
+      bp_meth->set_max_iter(2);
+      bp_meth->set_tol_PD(5e-4);
+   }
+
+   std::uniform_real_distribution<double> dist_swap(0, 1);
+
+   // the report of a segment: rank, round, temperature, energy, lowest energy, accepted swaps
+   const int report_size = 6;
+   const int tag_swap = 100;
+   const int tag_report = 101;
+   std::vector<double> report(report_size);
+   MPI_Request report_request = MPI_REQUEST_NULL;
+   unsigned int received_reports = 0;
+
+   auto print_report = [this] (const std::vector<double> &rep) {
+      std::cout << "P=" << int(rep[0]) << "\tRound " << int(rep[1]) << "\tT=" << rep[2] << "\tEnergy = " << rep[3] + ham->getEconst() << "\tLowest = " << rep[4] + ham->getEconst() << "\tSwaps = " << int(rep[5]) << std::endl;
+   };
+
+   auto drain_reports = [&] (bool wait) {
+      std::vector<double> rep(report_size);
+      int flag = 1;
+
+      while(received_reports < (size-1)*rounds)
+      {
+         if(!wait)
+         {
+            MPI_Iprobe(MPI_ANY_SOURCE, tag_report, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+
+            if(!flag)
+               break;
+         }
+
+         MPI_Recv(rep.data(), report_size, MPI_DOUBLE, MPI_ANY_SOURCE, tag_report, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+         received_reports++;
+         print_report(rep);
+      }
+   };
+
+   double lowest_energy = energy;
+   std::unique_ptr<UnitaryMatrix> lowest_unitary(new UnitaryMatrix(orbtrans->get_unitary()));
+   unsigned int swaps = 0;
+
+   auto start = std::chrono::high_resolution_clock::now();
+
+   for(unsigned int round=0;round<rounds;round++)
+   {
+      optimize();
+
+      if(energy < lowest_energy)
+      {
+         lowest_energy = energy;
+         *lowest_unitary = orbtrans->get_unitary();
+      }
+
+      // pairs (0,1),(2,3),... and (1,2),(3,4),... in turn
+      const int partner = (rank%2 == round%2) ? rank+1 : rank-1;
+
+      if(partner >= 0 && partner < size)
+      {
+         // our energy and a random number: the lowest rank of the pair decides with its random number
+         double mine[2] = {energy, dist_swap(mt)};
+         double theirs[2];
+         MPI_Request requests[2];
+
+         MPI_Irecv(theirs, 2, MPI_DOUBLE, partner, tag_swap, MPI_COMM_WORLD, &requests[0]);
+         MPI_Isend(mine, 2, MPI_DOUBLE, partner, tag_swap, MPI_COMM_WORLD, &requests[1]);
+         MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+
+         const double chance = std::exp((1.0/my_temp - 1.0/ladder(partner)) * (energy - theirs[0]));
+         const double u = (rank < partner) ? mine[1] : theirs[1];
+
+         if(u < chance)
+         {
+            orbtrans->get_unitary().exchange(partner);
+            energy = theirs[0];
+            swaps++;
+         }
+      }
+
+      report = {1.0*rank, 1.0*round, my_temp, energy, lowest_energy, 1.0*swaps};
+
+      if(rank == 0)
+      {
+         print_report(report);
+         drain_reports(false);
+      }
+      else
+      {
+         MPI_Wait(&report_request, MPI_STATUS_IGNORE);
+         MPI_Isend(report.data(), report_size, MPI_DOUBLE, 0, tag_report, MPI_COMM_WORLD, &report_request);
+      }
+   }
+
+   auto end = std::chrono::high_resolution_clock::now();
+
+   if(rank == 0)
+      drain_reports(true);
+   else
+      MPI_Wait(&report_request, MPI_STATUS_IGNORE);
+
+   // everybody continues with the lowest configuration
+   struct {
+      double energy;
+      int rank;
+   } lowest = {lowest_energy, rank};
+
+   MPI_Allreduce(MPI_IN_PLACE, &lowest, 1, MPI_DOUBLE_INT, MPI_MINLOC, MPI_COMM_WORLD);
+
+   orbtrans->get_unitary() = *lowest_unitary;
+   orbtrans->get_unitary().sendreceive(lowest.rank);
+   energy = calc_new_energy();
+
+   if(rank == 0)
+   {
+      std::cout << "Rank " << lowest.rank << " has the lowest energy => " << get_energy() << std::endl;
+      std::cout << "PT runtime: " << std::fixed << std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1>>>(end-start).count() << " s" << std::endl;
+   }
+}
+
 /* vim: set ts=3 sw=3 expandtab :*/
@@ -23,11 +23,13 @@
 
 #include <cstdio>
 #include <sstream>
+#include <algorithm>
 #include <assert.h>
 #include <hdf5.h>
 #include <signal.h>
 
 #include "include.h"
+#include "lapack.h"
 
 // if set, the signal has been given to stop the calculation and write current step to file
 extern sig_atomic_t stopping;
@@ -174,70 +176,33 @@ namespace doci2DM {
 }
 
 /**
- * Build the reduced hamiltonian using 2 function objects: one for the one particles integrals,
- * one for the two particle integrals. The functions should accept the spatial orbitals
- * as argument.
- * @param T a function that accepts 2 orbitals a and b and returns the <a|T|b> matrix element
- * @param V a function that accepts 4 orbitals a, b, c and d and returns the <ab|V|cd> matrix element
+ * Build the reduced hamiltonian from the DOCI integrals
+ * @param ints the integrals to use
  */
-void TPM::ham(std::function<double(int,int)> &T, std::function<double(int,int,int,int)> &V)
+void TPM::ham(const DociIntegrals &ints)
 {
-   // make our life easier
-   auto calc_elem = [this,&T,&V] (int i, int j) {
-      int a = (*t2s)(i,0);
-      int b = (*t2s)(i,1);
-      int c = (*t2s)(j,0);
-      int d = (*t2s)(j,1);
-
-      int a_ = a % L;
-      int b_ = b % L;
-      int c_ = c % L;
-      int d_ = d % L;
-
-      double result = 0;
-
-      // sp terms
-      if(i==j)
-         result += (T(a_,a_) + T(b_,b_))/(N - 1.0);
-
-      // tp terms:
-
-      // a \bar a ; b \bar b
-      if(b==(a+L) && d==(c+L))
-         result += V(a_,b_,c_,d_);
-
-      // a b ; a b
-      if(i==j && a<L && b<L && a!=b)
-         result += V(a_,b_,c_,d_) - V(a_,b_,d_,c_);
-
-      // \bar a \bar b ; \bar a \bar b
-      if(i==j && a>=L && b>=L && a!=b)
-         result += V(a_,b_,c_,d_) - V(a_,b_,d_,c_);
-
-      // a \bar b ; a \bar b
-      if(i==j && a<L && b>=L && a%L!=b%L)
-         result += V(a_,b_,c_,d_);
-
-      // \bar a b ; \bar a b
-      if(i==j && a>=L && b<L && a%L!=b%L)
-         result += V(a_,b_,c_,d_);
-
-      return result;
-   };
-
-
    auto& hamB = getMatrix(0);
 
-   for(int i=0;i<L;++i)
-      for(int j=i;j<L;++j)
-         hamB(i,j) = hamB(j,i) = calc_elem(i,j);
+   // a \bar a ; b \bar b
+   for(int a=0;a<L;++a)
+   {
+      for(int b=a+1;b<L;++b)
+         hamB(a,b) = hamB(b,a) = ints.Vaabb(a,b);
+
+      hamB(a,a) = 2*ints.T(a,a)/(N - 1.0) + ints.Vaabb(a,a);
+   }
 
    auto& hamV = getVector(0);
 
    for(int i=0;i<hamV.gn();i++)
-      // keep in mind that the degen of the vector is 4. We need prefactor of 2, so
-      // we end up with 0.5
-      hamV[i] = 0.5*calc_elem(L+i,L+i) + 0.5*calc_elem(L*L+i,L*L+i);
+   {
+      const int a = (*t2s)(L+i,0);
+      const int b = (*t2s)(L+i,1);
+
+      // keep in mind that the degen of the vector is 4: this is the average of
+      // a b ; a b and a \bar b ; a \bar b
+      hamV[i] = (ints.T(a,a) + ints.T(b,b))/(N - 1.0) + ints.Vabab(a,b) - 0.5*ints.Vabba(a,b);
+   }
 }
 
 void TPM::HF_molecule(std::string filename)
@@ -291,10 +256,18 @@ void TPM::HF_molecule(std::string filename)
 //            for(int d=0;d<L;d++)
 //               printf("%20.15f\t%d\t%d\t%d\t%d\n", TEI(a*L+b,c*L+d), a+1,c+1,b+1,d+1);
 
-   std::function<double(int,int)> getT = [&OEI] (int a, int b) -> double { return OEI(a,b); };
-   std::function<double(int,int,int,int)> getV = [&TEI,this] (int a, int b, int c, int d) -> double { return TEI(a*L + b,c*L + d); };
+   DociIntegrals ints(L);
 
-   ham(getT,getV);
+   for(int a=0;a<L;a++)
+      for(int b=0;b<L;b++)
+      {
+         ints.T(a,b) = OEI(a,b);
+         ints.Vaabb(a,b) = TEI(a*L + a,b*L + b);
+         ints.Vabab(a,b) = TEI(a*L + b,a*L + b);
+         ints.Vabba(a,b) = TEI(a*L + b,b*L + a);
+      }
+
+   ham(ints);
 }
 
 /**
@@ -539,8 +512,17 @@ void TPM::init(const Lineq &lineq)
 {
    (*this) = 0;
 
+   std::vector<double> coef(2*L, 0);
+
    for(int i=0;i<lineq.gnr();i++)
-      daxpy(lineq.ge_ortho(i), lineq.gE_ortho(i));
+   {
+      const double *constr = lineq.gE_ortho_orb(i);
+
+      for(int a=0;a<2*L;a++)
+         coef[a] += lineq.ge_ortho(i) * constr[a];
+   }
+
+   add_orbital_part(1.0, coef.data());
 }
 
 void TPM::Proj_Tr()
@@ -566,11 +548,27 @@ void TPM::Proj_Tr()
  * @param lineq the linear inequalities to use
  */
 void TPM::collaps(const SUP &S, const Lineq &lineq)
+{
+   TPM hulp(L,N);
+   std::vector<double> orb1(2*L);
+   std::vector<double> orb2(2*L);
+
+   collaps(S, lineq, hulp, orb1.data(), orb2.data());
+}
+
+/**
+ * Collaps the full SUP to the TPM space, see above.
+ * @param S The SUP to collaps
+ * @param lineq the linear inequalities to use
+ * @param hulp scratch TPM
+ * @param orb1 scratch array of 2L doubles
+ * @param orb2 scratch array of 2L doubles
+ */
+void TPM::collaps(const SUP &S, const Lineq &lineq, TPM &hulp, double *orb1, double *orb2)
 {
    (*this) = S.getI();
 
 #ifdef __Q_CON
-   TPM hulp(L,N);
    hulp.Q(S.getQ());
 
    (*this) += hulp;
@@ -582,7 +580,7 @@ void TPM::collaps(const SUP &S, const Lineq &lineq)
    *this += hulp;
 #endif
 
-   Proj_E(lineq);
+   Proj_E(lineq, orb1, orb2);
 }
 
 /**
@@ -851,18 +849,46 @@ void TPM::ReadFromFileFull(std::string filename)
  */
 void TPM::Proj_E(const Lineq &lineq, int option)
 {
-   double brecht;
+   std::vector<double> dual(2*L);
+   std::vector<double> coef(2*L);
+
+   Proj_E(lineq, dual.data(), coef.data(), option);
+}
+
+/**
+ * Same as above, but with the scratch space given by the caller
+ * @param lineq The object containing the linear constraints
+ * @param dual scratch array of 2L doubles
+ * @param coef scratch array of 2L doubles
+ * @param option project onto (option = 0) 0 or (option = 1) e
+ */
+void TPM::Proj_E(const Lineq &lineq, double *dual, double *coef, int option)
+{
+   const int dim = 2*L;
+
+   std::fill(coef, coef+dim, 0);
+
+   get_orbital_dual(dual);
 
    for(int i=0;i<lineq.gnr();++i)
    {
+      const double *constr = lineq.gE_ortho_orb(i);
+
+      //Tr(Gamma E~)
+      double brecht = 0;
+
+      for(int a=0;a<dim;a++)
+         brecht += dual[a] * constr[a];
+
       if(option == 1)
          //Tr(Gamma E~) - e~
-         brecht = this->ddot(lineq.gE_ortho(i)) - lineq.ge_ortho(i);
-      else
-         brecht = this->ddot(lineq.gE_ortho(i));
+         brecht -= lineq.ge_ortho(i);
 
-      this->daxpy(-brecht,lineq.gE_ortho(i));
+      for(int a=0;a<dim;a++)
+         coef[a] += brecht * constr[a];
    }
+
+   add_orbital_part(-1.0, coef);
 }
 
 /**
@@ -920,6 +946,37 @@ double TPM::getDiag(int a, int b) const
  * @param tpm_d the input TPM
  */
 void TPM::S(const TPM &tpm_d)
+{
+#ifdef __G_CON
+   PHM tmpG(L,N);
+   TPM tmp(L,N);
+
+   S(tpm_d, tmpG, tmp);
+#else
+   S_Q(tpm_d);
+#endif
+}
+
+/**
+ * The overlap map, using scratch space for the G part
+ * @param tpm_d the input TPM
+ * @param tmpG scratch PHM
+ * @param tmp scratch TPM
+ */
+void TPM::S(const TPM &tpm_d, PHM &tmpG, TPM &tmp)
+{
+   S_Q(tpm_d);
+
+#ifdef __G_CON
+   S_G(tpm_d, tmpG, tmp);
+#endif
+}
+
+/**
+ * The Q-like part of the overlap map
+ * @param tpm_d the input TPM
+ */
+void TPM::S_Q(const TPM &tpm_d)
 {
    double a = 1.0;
    double b = 0.0;
@@ -958,16 +1015,21 @@ void TPM::S(const TPM &tpm_d)
 //#endif
 
    this->Q(a,b,c,tpm_d);
+}
 
-#ifdef __G_CON
-   PHM tmpG(L,N);
+/**
+ * Add the G part of the overlap map to *this
+ * @param tpm_d the input TPM
+ * @param tmpG scratch PHM
+ * @param tmp scratch TPM
+ */
+void TPM::S_G(const TPM &tpm_d, PHM &tmpG, TPM &tmp)
+{
    tmpG.G(tpm_d);
 
-   TPM tmp(L,N);
    tmp.G(tmpG);
 
    (*this) += tmp;
-#endif
 }
 
 /**
@@ -980,25 +1042,59 @@ void TPM::S(const TPM &tpm_d)
  */
 int TPM::InverseS(TPM &b, const Lineq &lineq)
 {
+   if(lineq.has_inverse_S())
+   {
+      InverseS_direct(b, lineq);
+      return 0;
+   }
+
+   TPM r(L,N);
+   TPM Hb(L,N);
+   PHM tmpG(L,N);
+   TPM tmp(L,N);
+   std::vector<double> orb1(2*L);
+   std::vector<double> orb2(2*L);
+
+   return InverseS(b, lineq, r, Hb, tmpG, tmp, orb1.data(), orb2.data());
+}
+
+/**
+ * Same as above, but with all the temporary objects given
+ * by the caller
+ * @param b the input matrix
+ * @param lineq the constrains to use
+ * @param r scratch TPM for the residual
+ * @param Hb scratch TPM for the image of b
+ * @param tmpG scratch PHM for the overlap map
+ * @param tmp scratch TPM for the overlap map
+ * @param orb1 scratch array of 2L doubles
+ * @param orb2 scratch array of 2L doubles
+ * @returns the number of iterations
+ */
+int TPM::InverseS(TPM &b, const Lineq &lineq, TPM &r, TPM &Hb, PHM &tmpG, TPM &tmp, double *orb1, double *orb2)
+{
+   if(lineq.has_inverse_S())
+   {
+      InverseS_direct(b, lineq, orb1, orb2);
+      return 0;
+   }
+
    *this = 0;
 
    //de r initialiseren op b
-   TPM r(b);
+   r = b;
 
    double rr = r.ddot(r);
    double rr_old,ward;
 
-   //nog de Hb aanmaken ook, maar niet initialiseren:
-   TPM Hb(L,N);
-
    int cg_iter = 0;
 
    while(rr > 1.0e-10)
    {
       ++cg_iter;
 
-      Hb.S(b);
-      Hb.Proj_E(lineq);
+      Hb.S(b, tmpG, tmp);
+      Hb.Proj_E(lineq, orb1, orb2);
 
       ward = rr/b.ddot(Hb);
 
@@ -1012,16 +1108,148 @@ int TPM::InverseS(TPM &b, const Lineq &lineq)
       rr_old = rr;
       rr = r.ddot(r);
 
-      //eerst herschalen van b
-      b.dscal(rr/rr_old);
-
-      //dan r er bijtellen
-      b += r;
+      //herschalen van b en r er bijtellen
+      b = (rr/rr_old) * b + r;
    }
 
    return cg_iter;
 }
 
+/**
+ * Apply the inverse of the overlap map directly, using the
+ * factorization precomputed in Lineq (see Lineq::constr_inverse_S).
+ * The overlap map is a multiple of the identity on everything
+ * except the orbital part of the TPM (see get_orbital_part), so only
+ * a 2L x 2L matrix is needed. Store the result in *this.
+ * @param b the input matrix, should satisfy the (homogeneous) constraints
+ * @param lineq the constrains to use
+ */
+void TPM::InverseS_direct(const TPM &b, const Lineq &lineq)
+{
+   std::vector<double> mu(2*L);
+   std::vector<double> res(2*L);
+
+   InverseS_direct(b, lineq, mu.data(), res.data());
+}
+
+/**
+ * Same as above, but with the scratch space given by the caller
+ * @param b the input matrix, should satisfy the (homogeneous) constraints
+ * @param lineq the constrains to use
+ * @param mu scratch array of 2L doubles
+ * @param res scratch array of 2L doubles
+ */
+void TPM::InverseS_direct(const TPM &b, const Lineq &lineq, double *mu, double *res)
+{
+   assert(lineq.has_inverse_S());
+
+   int dim = 2*L;
+
+   b.get_orbital_part(mu);
+
+   // everything outside the orbital part
+   (*this) = b;
+   add_orbital_part(-1.0, mu);
+   dscal(1.0/lineq.gS_kappa());
+
+   // the orbital part
+   char trans = 'N';
+   double alpha = 1.0;
+   double beta = 0.0;
+   int inc = 1;
+
+   dgemv_(&trans,&dim,&dim,&alpha,const_cast<double *>(lineq.gS_inv()),&dim,mu,&inc,&beta,res,&inc);
+
+   add_orbital_part(1.0, res);
+}
+
+/**
+ * The orbital part of a TPM: the diagonal of the LxL block, m_a, and
+ * the part of the vector that can be written as v_ab = u_a + u_b.
+ * The rest of the vector has zero row sums.
+ * @param mu array of size 2L to store (m,u) in
+ */
+void TPM::get_orbital_part(double *mu) const
+{
+   assert(L>2);
+
+   double *m = mu;
+   double *u = mu + L;
+
+   for(int a=0;a<L;a++)
+   {
+      m[a] = (*this)(0,a,a);
+      u[a] = 0;
+   }
+
+   // the row sums of v
+   for(int i=0;i<gdimVector(0);i++)
+   {
+      const int a = (*t2s)(L+i,0);
+      const int b = (*t2s)(L+i,1);
+
+      u[a] += (*this)(0,i);
+      u[b] += (*this)(0,i);
+   }
+
+   // row sum r_a = (L-2) u_a + sum_b u_b
+   double U = 0;
+   for(int a=0;a<L;a++)
+      U += u[a];
+
+   U /= 2.0*(L-1);
+
+   for(int a=0;a<L;a++)
+      u[a] = (u[a] - U)/(L-2.0);
+}
+
+/**
+ * The coefficients to calculate the ddot of this TPM with a TPM
+ * given in orbital coordinates (m,u): ddot = sum_a dual_a (m,u)_a.
+ * This is the diagonal of the block and 4 times the row sums of the vector.
+ * @param dual array of size 2L to store the coefficients in
+ */
+void TPM::get_orbital_dual(double *dual) const
+{
+   for(int a=0;a<L;a++)
+   {
+      dual[a] = (*this)(0,a,a);
+      dual[L+a] = 0;
+   }
+
+   for(int i=0;i<gdimVector(0);i++)
+   {
+      const int a = (*t2s)(L+i,0);
+      const int b = (*t2s)(L+i,1);
+
+      dual[L+a] += 4 * (*this)(0,i);
+      dual[L+b] += 4 * (*this)(0,i);
+   }
+}
+
+/**
+ * Add alpha times the orbital part (m,u) to this TPM. See
+ * get_orbital_part.
+ * @param alpha the scaling factor
+ * @param mu array of size 2L with (m,u)
+ */
+void TPM::add_orbital_part(double alpha, const double *mu)
+{
+   const double *m = mu;
+   const double *u = mu + L;
+
+   for(int a=0;a<L;a++)
+      (*this)(0,a,a) += alpha * m[a];
+
+   for(int i=0;i<gdimVector(0);i++)
+   {
+      const int a = (*t2s)(L+i,0);
+      const int b = (*t2s)(L+i,1);
+
+      (*this)(0,i) += alpha * (u[a] + u[b]);
+   }
+}
+
 /**
  * The down image of the DOCI-G image.
  * Fills the current object with the G down image of phm
@@ -1032,13 +1260,13 @@ void TPM::G(const PHM &phm)
    std::vector<double> B11(L,0);
    std::vector<double> B22(L,0);
 
+   const auto &lxl = phm.getLxL();
+
    for(int a=0;a<L;a++)
       for(int b=a+1;b<L;b++)
       {
-         auto &block = phm.getBlock(a,b);
-
-         B11[a] += block(0,0);
-         B22[b] += block(1,1);
+         B11[a] += phm.get2x2(a,b,0,0);
+         B22[b] += phm.get2x2(a,b,1,1);
       }
 
    for(int i=0;i<gdimVector(0);++i)
@@ -1046,20 +1274,15 @@ void TPM::G(const PHM &phm)
       const int a = (*t2s)(L+i,0);
       const int b = (*t2s)(L+i,1);
 
-      auto &block = phm.getBlock(a,b);
-
-      (*this)(0,i) = 0.25*(2.0/(N-1.0)*(phm[0](a,a)+phm[0](b,b)+B11[a]+B11[b]+B22[a]+B22[b]) - block(0,0) - block(1,1) + 2*phm[0](a,b));
+      (*this)(0,i) = 0.25*(2.0/(N-1.0)*(lxl(a,a)+lxl(b,b)+B11[a]+B11[b]+B22[a]+B22[b]) - phm.get2x2(a,b,0,0) - phm.get2x2(a,b,1,1) + 2*lxl(a,b));
    }
 
    for(int a=0;a<L;a++)
    {
       for(int b=a+1;b<L;b++)
-      {
-         auto &block = phm.getBlock(a,b);
-         (*this)(0,a,b) = (*this)(0,b,a) = -block(0,1);
-      }
+         (*this)(0,a,b) = (*this)(0,b,a) = -phm.get2x2(a,b,0,1);
 
-      (*this)(0,a,a) = 1.0/(N-1.0)*(B11[a]+B22[a]+phm[0](a,a));
+      (*this)(0,a,a) = 1.0/(N-1.0)*(B11[a]+B22[a]+lxl(a,a));
    }
 }
 
@@ -1424,63 +1647,85 @@ double TPM::calc_rotate_slow(int k, int l, double theta, std::function<double(in
  * @param k the first orbital
  * @param l the second orbital
  * @param theta the angle to rotate over
- * @param T function that returns the one-particle matrix elements
- * @param V function that returns the two-particle matrix elements
+ * @param ints the DOCI integrals (with the k/l slices)
  * @return the new energy
  */
-double TPM::calc_rotate(int k, int l, double theta, std::function<double(int,int)> &T, std::function<double(int,int,int,int)> &V) const
+double TPM::calc_rotate(int k, int l, double theta, const DociIntegrals &ints) const
+{
+   std::vector<double> slice(3*L);
+
+   return calc_rotate(k, l, theta, ints, slice.data());
+}
+
+/**
+ * Same as above, but with the scratch space given by the caller
+ * @param k the first orbital
+ * @param l the second orbital
+ * @param theta the angle to rotate over
+ * @param ints the DOCI integrals (with the k/l slices)
+ * @param slice scratch array of 3L doubles for the k/l slices of the integrals
+ * @return the new energy
+ */
+double TPM::calc_rotate(int k, int l, double theta, const DociIntegrals &ints, double *slice) const
 {
    assert(k!=l);
 
+   // the k/l slices of the integrals
+   ints.get_slice(k, l, slice);
+
+   const double *Vklaa = slice;
+   const double *Vkala = slice + L;
+   const double *Vkaal = slice + 2*L;
+
    const TPM &rdm = *this;
 
-   double energy = 4/(N-1.0)*(T(k,k)+T(l,l)) * rdm(k,l,k,l);
+   double energy = 4/(N-1.0)*(ints.T(k,k)+ints.T(l,l)) * rdm(k,l,k,l);
 
-   double cos2 = 2.0/(N-1.0)*(T(k,k)*rdm(k,k+L,k,k+L)+T(l,l)*rdm(l,l+L,l,l+L));
+   double cos2 = 2.0/(N-1.0)*(ints.T(k,k)*rdm(k,k+L,k,k+L)+ints.T(l,l)*rdm(l,l+L,l,l+L));
 
-   double sin2 = 2.0/(N-1.0)*(T(l,l)*rdm(k,k+L,k,k+L)+T(k,k)*rdm(l,l+L,l,l+L));
+   double sin2 = 2.0/(N-1.0)*(ints.T(l,l)*rdm(k,k+L,k,k+L)+ints.T(k,k)*rdm(l,l+L,l,l+L));
 
    // 2sincos actually
-   double sincos = 2.0/(N-1.0)*T(k,l)*(rdm(l,l+L,l,l+L)-rdm(k,k+L,k,k+L));
+   double sincos = 2.0/(N-1.0)*ints.T(k,l)*(rdm(l,l+L,l,l+L)-rdm(k,k+L,k,k+L));
 
    for(int a=0;a<L;a++)
    {
       if(a==k || a==l)
          continue;
 
-      energy += 2.0/(N-1.0) * T(a,a) * (rdm(a,a+L,a,a+L)+2*rdm(a,k,a,k)+2*rdm(a,l,a,l));
+      energy += 2.0/(N-1.0) * ints.T(a,a) * (rdm(a,a+L,a,a+L)+2*rdm(a,k,a,k)+2*rdm(a,l,a,l));
 
       for(int b=0;b<L;b++)
       {
          if(b==k || b==l)
             continue;
 
-         energy += 2.0/(N-1.0) * (T(a,a)+T(b,b)) * rdm(a,b,a,b);
+         energy += 2.0/(N-1.0) * (ints.T(a,a)+ints.T(b,b)) * rdm(a,b,a,b);
 
-         energy += V(a,a,b,b) * rdm(a,a+L,b,b+L);
+         energy += ints.Vaabb(a,b) * rdm(a,a+L,b,b+L);
 
-         energy += (2*V(a,b,a,b)-V(a,b,b,a)) * rdm(a,b,a,b);
+         energy += (2*ints.Vabab(a,b)-ints.Vabba(a,b)) * rdm(a,b,a,b);
       }
 
-      cos2 += 2*V(k,k,a,a)*rdm(k,k+L,a,a+L)+2*V(l,l,a,a)*rdm(l,l+L,a,a+L)+2*(2*V(k,a,k,a)-V(k,a,a,k)+2.0/(N-1.0)*T(k,k))*rdm(k,a,k,a)+2*(2*V(l,a,l,a)-V(l,a,a,l)+2.0/(N-1.0)*T(l,l))*rdm(l,a,l,a);
+      cos2 += 2*ints.Vaabb(k,a)*rdm(k,k+L,a,a+L)+2*ints.Vaabb(l,a)*rdm(l,l+L,a,a+L)+2*(2*ints.Vabab(k,a)-ints.Vabba(k,a)+2.0/(N-1.0)*ints.T(k,k))*rdm(k,a,k,a)+2*(2*ints.Vabab(l,a)-ints.Vabba(l,a)+2.0/(N-1.0)*ints.T(l,l))*rdm(l,a,l,a);
 
-      sin2 += 2*V(l,l,a,a)*rdm(k,k+L,a,a+L)+2*V(k,k,a,a)*rdm(l,l+L,a,a+L)+2*(2*V(k,a,k,a)-V(k,a,a,k)+2.0/(N-1.0)*T(k,k))*rdm(l,a,l,a)+2*(2*V(l,a,l,a)-V(l,a,a,l)+2.0/(N-1.0)*T(l,l))*rdm(k,a,k,a);
+      sin2 += 2*ints.Vaabb(l,a)*rdm(k,k+L,a,a+L)+2*ints.Vaabb(k,a)*rdm(l,l+L,a,a+L)+2*(2*ints.Vabab(k,a)-ints.Vabba(k,a)+2.0/(N-1.0)*ints.T(k,k))*rdm(l,a,l,a)+2*(2*ints.Vabab(l,a)-ints.Vabba(l,a)+2.0/(N-1.0)*ints.T(l,l))*rdm(k,a,k,a);
 
-      sincos += 2*V(k,l,a,a)*(rdm(l,l+L,a,a+L)-rdm(k,k+L,a,a+L))+2*(2*V(k,a,l,a)-V(k,a,a,l)+2.0/(N-1.0)*T(k,l))*(rdm(l,a,l,a)-rdm(k,a,k,a));
+      sincos += 2*Vklaa[a]*(rdm(l,l+L,a,a+L)-rdm(k,k+L,a,a+L))+2*(2*Vkala[a]-Vkaal[a]+2.0/(N-1.0)*ints.T(k,l))*(rdm(l,a,l,a)-rdm(k,a,k,a));
    }
 
-   const double cos4 = V(k,k,k,k)*rdm(k,k+L,k,k+L)+V(l,l,l,l)*rdm(l,l+L,l,l+L)+2*V(k,k,l,l)*rdm(k,k+L,l,l+L)+2*(2*V(k,l,k,l)-V(k,k,l,l))*rdm(k,l,k,l);
+   const double cos4 = ints.Vaabb(k,k)*rdm(k,k+L,k,k+L)+ints.Vaabb(l,l)*rdm(l,l+L,l,l+L)+2*ints.Vaabb(k,l)*rdm(k,k+L,l,l+L)+2*(2*ints.Vabab(k,l)-ints.Vaabb(k,l))*rdm(k,l,k,l);
 
-   const double sin4 = V(k,k,k,k)*rdm(l,l+L,l,l+L)+V(l,l,l,l)*rdm(k,k+L,k,k+L)+2*V(k,k,l,l)*rdm(k,k+L,l,l+L)+2*(2*V(k,l,k,l)-V(k,k,l,l))*rdm(k,l,k,l);
+   const double sin4 = ints.Vaabb(k,k)*rdm(l,l+L,l,l+L)+ints.Vaabb(l,l)*rdm(k,k+L,k,k+L)+2*ints.Vaabb(k,l)*rdm(k,k+L,l,l+L)+2*(2*ints.Vabab(k,l)-ints.Vaabb(k,l))*rdm(k,l,k,l);
 
    // 2 x
-   const double cos2sin2 = (2*V(k,k,l,l)+V(k,l,k,l))*(rdm(k,k+L,k,k+L)+rdm(l,l+L,l,l+L))+((V(k,k,k,k)+V(l,l,l,l)-2*(V(k,l,k,l)+V(k,k,l,l))))*rdm(k,k+L,l,l+L)+(V(k,k,k,k)+V(l,l,l,l)-6*V(k,k,l,l)+2*V(k,l,k,l))*rdm(k,l,k,l);
+   const double cos2sin2 = (2*ints.Vaabb(k,l)+ints.Vabab(k,l))*(rdm(k,k+L,k,k+L)+rdm(l,l+L,l,l+L))+((ints.Vaabb(k,k)+ints.Vaabb(l,l)-2*(ints.Vabab(k,l)+ints.Vaabb(k,l))))*rdm(k,k+L,l,l+L)+(ints.Vaabb(k,k)+ints.Vaabb(l,l)-6*ints.Vaabb(k,l)+2*ints.Vabab(k,l))*rdm(k,l,k,l);
 
    // 4 x
-   const double sin3cos = V(k,l,k,k)*rdm(l,l+L,l,l+L)-V(k,l,l,l)*rdm(k,k+L,k,k+L)-(V(k,l,k,k)-V(k,l,l,l))*(rdm(k,k+L,l,l+L)+rdm(k,l,k,l));
+   const double sin3cos = Vklaa[k]*rdm(l,l+L,l,l+L)-Vklaa[l]*rdm(k,k+L,k,k+L)-(Vklaa[k]-Vklaa[l])*(rdm(k,k+L,l,l+L)+rdm(k,l,k,l));
 
    // 4 x
-   const double cos3sin = V(k,l,l,l)*rdm(l,l+L,l,l+L)-V(k,l,k,k)*rdm(k,k+L,k,k+L)+(V(k,l,k,k)-V(k,l,l,l))*(rdm(k,k+L,l,l+L)+rdm(k,l,k,l));
+   const double cos3sin = Vklaa[l]*rdm(l,l+L,l,l+L)-Vklaa[k]*rdm(k,k+L,k,k+L)+(Vklaa[k]-Vklaa[l])*(rdm(k,k+L,l,l+L)+rdm(k,l,k,l));
 
    const double cos = std::cos(theta);
    const double sin = std::sin(theta);
@@ -1570,49 +1815,71 @@ double TPM::calc_rotate(int k, int l, double theta, std::function<double(int,int
  * @param k the first orbital
  * @param l the second orbital
  * @param start_angle the starting point for the Newton-Raphson (defaults to zero)
- * @param T function that returns the one-particle matrix elements
- * @param V function that returns the two-particle matrix elements
+ * @param ints the DOCI integrals (with the k/l slices)
+ * @return pair of the angle with the lowest energy and boolean, true => minimum, false => maximum
+ */
+std::pair<double,bool> TPM::find_min_angle(int k, int l, double start_angle, const DociIntegrals &ints) const
+{
+   std::vector<double> slice(3*L);
+
+   return find_min_angle(k, l, start_angle, ints, slice.data());
+}
+
+/**
+ * Same as above, but with the scratch space given by the caller
+ * @param k the first orbital
+ * @param l the second orbital
+ * @param start_angle the starting point for the Newton-Raphson (defaults to zero)
+ * @param ints the DOCI integrals (with the k/l slices)
+ * @param slice scratch array of 3L doubles for the k/l slices of the integrals
  * @return pair of the angle with the lowest energy and boolean, true => minimum, false => maximum
  */
-std::pair<double,bool> TPM::find_min_angle(int k, int l, double start_angle, std::function<double(int,int)> &T, std::function<double(int,int,int,int)> &V) const
+std::pair<double,bool> TPM::find_min_angle(int k, int l, double start_angle, const DociIntegrals &ints, double *slice) const
 {
    assert(k!=l);
 
+   // the k/l slices of the integrals
+   ints.get_slice(k, l, slice);
+
+   const double *Vklaa = slice;
+   const double *Vkala = slice + L;
+   const double *Vkaal = slice + 2*L;
+
    double theta = start_angle;
 
    const TPM &rdm = *this;
 
-   double cos2 = 2.0/(N-1.0)*(T(k,k)*rdm(k,k+L,k,k+L)+T(l,l)*rdm(l,l+L,l,l+L));
+   double cos2 = 2.0/(N-1.0)*(ints.T(k,k)*rdm(k,k+L,k,k+L)+ints.T(l,l)*rdm(l,l+L,l,l+L));
 
-   double sin2 = 2.0/(N-1.0)*(T(l,l)*rdm(k,k+L,k,k+L)+T(k,k)*rdm(l,l+L,l,l+L));
+   double sin2 = 2.0/(N-1.0)*(ints.T(l,l)*rdm(k,k+L,k,k+L)+ints.T(k,k)*rdm(l,l+L,l,l+L));
 
    // 2sincos actually
-   double sincos = 2.0/(N-1.0)*T(k,l)*(rdm(l,l+L,l,l+L)-rdm(k,k+L,k,k+L));
+   double sincos = 2.0/(N-1.0)*ints.T(k,l)*(rdm(l,l+L,l,l+L)-rdm(k,k+L,k,k+L));
 
    for(int a=0;a<L;a++)
    {
       if(a==k || a==l)
          continue;
 
-      cos2 += 2*V(k,k,a,a)*rdm(k,k+L,a,a+L)+2*V(l,l,a,a)*rdm(l,l+L,a,a+L)+2*(2*V(k,a,k,a)-V(k,a,a,k)+2.0/(N-1.0)*T(k,k))*rdm(k,a,k,a)+2*(2*V(l,a,l,a)-V(l,a,a,l)+2.0/(N-1.0)*T(l,l))*rdm(l,a,l,a);
+      cos2 += 2*ints.Vaabb(k,a)*rdm(k,k+L,a,a+L)+2*ints.Vaabb(l,a)*rdm(l,l+L,a,a+L)+2*(2*ints.Vabab(k,a)-ints.Vabba(k,a)+2.0/(N-1.0)*ints.T(k,k))*rdm(k,a,k,a)+2*(2*ints.Vabab(l,a)-ints.Vabba(l,a)+2.0/(N-1.0)*ints.T(l,l))*rdm(l,a,l,a);
 
-      sin2 += 2*V(l,l,a,a)*rdm(k,k+L,a,a+L)+2*V(k,k,a,a)*rdm(l,l+L,a,a+L)+2*(2*V(k,a,k,a)-V(k,a,a,k)+2.0/(N-1.0)*T(k,k))*rdm(l,a,l,a)+2*(2*V(l,a,l,a)-V(l,a,a,l)+2.0/(N-1.0)*T(l,l))*rdm(k,a,k,a);
+      sin2 += 2*ints.Vaabb(l,a)*rdm(k,k+L,a,a+L)+2*ints.Vaabb(k,a)*rdm(l,l+L,a,a+L)+2*(2*ints.Vabab(k,a)-ints.Vabba(k,a)+2.0/(N-1.0)*ints.T(k,k))*rdm(l,a,l,a)+2*(2*ints.Vabab(l,a)-ints.Vabba(l,a)+2.0/(N-1.0)*ints.T(l,l))*rdm(k,a,k,a);
 
-      sincos += 2*V(k,l,a,a)*(rdm(l,l+L,a,a+L)-rdm(k,k+L,a,a+L))+2*(2*V(k,a,l,a)-V(k,a,a,l)+2.0/(N-1.0)*T(k,l))*(rdm(l,a,l,a)-rdm(k,a,k,a));
+      sincos += 2*Vklaa[a]*(rdm(l,l+L,a,a+L)-rdm(k,k+L,a,a+L))+2*(2*Vkala[a]-Vkaal[a]+2.0/(N-1.0)*ints.T(k,l))*(rdm(l,a,l,a)-rdm(k,a,k,a));
    }
 
-   const double cos4 = V(k,k,k,k)*rdm(k,k+L,k,k+L)+V(l,l,l,l)*rdm(l,l+L,l,l+L)+2*V(k,k,l,l)*rdm(k,k+L,l,l+L)+2*(2*V(k,l,k,l)-V(k,k,l,l))*rdm(k,l,k,l);
+   const double cos4 = ints.Vaabb(k,k)*rdm(k,k+L,k,k+L)+ints.Vaabb(l,l)*rdm(l,l+L,l,l+L)+2*ints.Vaabb(k,l)*rdm(k,k+L,l,l+L)+2*(2*ints.Vabab(k,l)-ints.Vaabb(k,l))*rdm(k,l,k,l);
 
-   const double sin4 = V(k,k,k,k)*rdm(l,l+L,l,l+L)+V(l,l,l,l)*rdm(k,k+L,k,k+L)+2*V(k,k,l,l)*rdm(k,k+L,l,l+L)+2*(2*V(k,l,k,l)-V(k,k,l,l))*rdm(k,l,k,l);
+   const double sin4 = ints.Vaabb(k,k)*rdm(l,l+L,l,l+L)+ints.Vaabb(l,l)*rdm(k,k+L,k,k+L)+2*ints.Vaabb(k,l)*rdm(k,k+L,l,l+L)+2*(2*ints.Vabab(k,l)-ints.Vaabb(k,l))*rdm(k,l,k,l);
 
    // 2 x
-   const double cos2sin2 = (2*V(k,k,l,l)+V(k,l,k,l))*(rdm(k,k+L,k,k+L)+rdm(l,l+L,l,l+L))+((V(k,k,k,k)+V(l,l,l,l)-2*(V(k,l,k,l)+V(k,k,l,l))))*rdm(k,k+L,l,l+L)+(V(k,k,k,k)+V(l,l,l,l)-6*V(k,k,l,l)+2*V(k,l,k,l))*rdm(k,l,k,l);
+   const double cos2sin2 = (2*ints.Vaabb(k,l)+ints.Vabab(k,l))*(rdm(k,k+L,k,k+L)+rdm(l,l+L,l,l+L))+((ints.Vaabb(k,k)+ints.Vaabb(l,l)-2*(ints.Vabab(k,l)+ints.Vaabb(k,l))))*rdm(k,k+L,l,l+L)+(ints.Vaabb(k,k)+ints.Vaabb(l,l)-6*ints.Vaabb(k,l)+2*ints.Vabab(k,l))*rdm(k,l,k,l);
 
    // 4 x
-   const double sin3cos = V(k,l,k,k)*rdm(l,l+L,l,l+L)-V(k,l,l,l)*rdm(k,k+L,k,k+L)-(V(k,l,k,k)-V(k,l,l,l))*(rdm(k,k+L,l,l+L)+rdm(k,l,k,l));
+   const double sin3cos = Vklaa[k]*rdm(l,l+L,l,l+L)-Vklaa[l]*rdm(k,k+L,k,k+L)-(Vklaa[k]-Vklaa[l])*(rdm(k,k+L,l,l+L)+rdm(k,l,k,l));
 
    // 4 x
-   const double cos3sin = V(k,l,l,l)*rdm(l,l+L,l,l+L)-V(k,l,k,k)*rdm(k,k+L,k,k+L)+(V(k,l,k,k)-V(k,l,l,l))*(rdm(k,k+L,l,l+L)+rdm(k,l,k,l));
+   const double cos3sin = Vklaa[l]*rdm(l,l+L,l,l+L)-Vklaa[k]*rdm(k,k+L,k,k+L)+(Vklaa[k]-Vklaa[l])*(rdm(k,k+L,l,l+L)+rdm(k,l,k,l));
 
    // A*cos(t)^4+B*sin(t)^4+C*cos(t)^2+D*sin(t)^2+2*E*cos(t)*sin(t)+2*F*cos(t)^2*sin(t)^2+4*G*sin(t)*cos(t)^3+4*H*sin(t)^3*cos(t)
 
@@ -1678,13 +1945,34 @@ std::pair<double,bool> TPM::find_min_angle(int k, int l, double start_angle, std
  * @param k the first orbital
  * @param l the second orbital
  * @param angle the angle to rotate over
- * @param T function that returns the one-particle matrix elements
- * @param V function that returns the two-particle matrix elements
+ * @param ints the DOCI integrals (with the k/l slices)
  */
-void TPM::rotate(int k, int l, double angle, std::function<double(int,int)> &T, std::function<double(int,int,int,int)> &V)
+void TPM::rotate(int k, int l, double angle, const DociIntegrals &ints)
+{
+   std::vector<double> slice(3*L);
+
+   rotate(k, l, angle, ints, slice.data());
+}
+
+/**
+ * Same as above, but with the scratch space given by the caller
+ * @param k the first orbital
+ * @param l the second orbital
+ * @param angle the angle to rotate over
+ * @param ints the DOCI integrals (with the k/l slices)
+ * @param slice scratch array of 3L doubles for the k/l slices of the integrals
+ */
+void TPM::rotate(int k, int l, double angle, const DociIntegrals &ints, double *slice)
 {
    assert(k!=l);
 
+   // the k/l slices of the integrals
+   ints.get_slice(k, l, slice);
+
+   const double *Vklaa = slice;
+   const double *Vkala = slice + L;
+   const double *Vkaal = slice + 2*L;
+
    auto& rdmB = getMatrix(0);
    auto& rdmV = getVector(0);
 
@@ -1705,37 +1993,37 @@ void TPM::rotate(int k, int l, double angle, std::function<double(int,int)> &T,
          continue;
 
       // k \bar k ; p \bar p
-      rdmB(k,p) = rdmB(p,k) = cos2*V(k,k,p,p)-2*cossin*V(k,l,p,p)+sin2*V(l,l,p,p);
+      rdmB(k,p) = rdmB(p,k) = cos2*ints.Vaabb(k,p)-2*cossin*Vklaa[p]+sin2*ints.Vaabb(l,p);
       // l \bar l ; p \bar p
-      rdmB(l,p) = rdmB(p,l) = cos2*V(l,l,p,p)+2*cossin*V(k,l,p,p)+sin2*V(k,k,p,p);
+      rdmB(l,p) = rdmB(p,l) = cos2*ints.Vaabb(l,p)+2*cossin*Vklaa[p]+sin2*ints.Vaabb(k,p);
 
       int idx = (*s2t)(k,p) - L;
 
       // k p ; k p
-      rdmV[idx] = 1.0/(N-1.0) * (T(p,p) + cos2*T(k,k)-2*cossin*T(k,l)+sin2*T(l,l)); 
-      rdmV[idx] += cos2*(V(k,p,k,p)-0.5*V(k,p,p,k))-2*cossin*(V(k,p,l,p)-0.5*V(k,p,p,l))+sin2*(V(l,p,l,p)-0.5*V(l,p,p,l));
+      rdmV[idx] = 1.0/(N-1.0) * (ints.T(p,p) + cos2*ints.T(k,k)-2*cossin*ints.T(k,l)+sin2*ints.T(l,l)); 
+      rdmV[idx] += cos2*(ints.Vabab(k,p)-0.5*ints.Vabba(k,p))-2*cossin*(Vkala[p]-0.5*Vkaal[p])+sin2*(ints.Vabab(l,p)-0.5*ints.Vabba(l,p));
 
       idx = (*s2t)(l,p) - L;
 
       // l p ; l p
-      rdmV[idx] = 1.0/(N-1.0) * (T(p,p) + cos2*T(l,l)+2*cossin*T(k,l)+sin2*T(k,k)); 
-      rdmV[idx] += cos2*(V(l,p,l,p)-0.5*V(l,p,p,l))+2*cossin*(V(l,p,k,p)-0.5*V(k,p,p,l))+sin2*(V(k,p,k,p)-0.5*V(k,p,p,k));
+      rdmV[idx] = 1.0/(N-1.0) * (ints.T(p,p) + cos2*ints.T(l,l)+2*cossin*ints.T(k,l)+sin2*ints.T(k,k)); 
+      rdmV[idx] += cos2*(ints.Vabab(l,p)-0.5*ints.Vabba(l,p))+2*cossin*(Vkala[p]-0.5*Vkaal[p])+sin2*(ints.Vabab(k,p)-0.5*ints.Vabba(k,p));
    }
 
    // k \bar k ; k \bar k
-   rdmB(k,k) = 2.0/(N-1.0) * (cos2*T(k,k)-2*cossin*T(k,l)+sin2*T(l,l));
-   rdmB(k,k) += cos4*V(k,k,k,k)+sin4*V(l,l,l,l)+cos2sin2*(4*V(k,k,l,l)+2*V(k,l,k,l))-4*cossin3*V(k,l,l,l)-4*cos3sin*V(k,l,k,k);
+   rdmB(k,k) = 2.0/(N-1.0) * (cos2*ints.T(k,k)-2*cossin*ints.T(k,l)+sin2*ints.T(l,l));
+   rdmB(k,k) += cos4*ints.Vaabb(k,k)+sin4*ints.Vaabb(l,l)+cos2sin2*(4*ints.Vaabb(k,l)+2*ints.Vabab(k,l))-4*cossin3*Vklaa[l]-4*cos3sin*Vklaa[k];
 
    // l \bar l ; l \bar l
-   rdmB(l,l) = 2.0/(N-1.0) * (cos2*T(l,l)+2*cossin*T(k,l)+sin2*T(k,k));
-   rdmB(l,l) += sin4*V(k,k,k,k)+cos4*V(l,l,l,l)+cos2sin2*(4*V(k,k,l,l)+2*V(k,l,k,l))+4*cossin3*V(k,l,k,k)+4*cos3sin*V(k,l,l,l);
+   rdmB(l,l) = 2.0/(N-1.0) * (cos2*ints.T(l,l)+2*cossin*ints.T(k,l)+sin2*ints.T(k,k));
+   rdmB(l,l) += sin4*ints.Vaabb(k,k)+cos4*ints.Vaabb(l,l)+cos2sin2*(4*ints.Vaabb(k,l)+2*ints.Vabab(k,l))+4*cossin3*Vklaa[k]+4*cos3sin*Vklaa[l];
 
    // k \bar k ; l \bar l
-   rdmB(k,l) = rdmB(l,k) = cos2sin2*(V(k,k,k,k)+V(l,l,l,l)-2*(V(k,l,k,l)+V(k,k,l,l)))+(cos4+sin4)*V(k,k,l,l)+2*(cos3sin-cossin3)*(V(k,l,k,k)-V(k,l,l,l));
+   rdmB(k,l) = rdmB(l,k) = cos2sin2*(ints.Vaabb(k,k)+ints.Vaabb(l,l)-2*(ints.Vabab(k,l)+ints.Vaabb(k,l)))+(cos4+sin4)*ints.Vaabb(k,l)+2*(cos3sin-cossin3)*(Vklaa[k]-Vklaa[l]);
 
    // k l ; k l
    int idx = (*s2t)(k,l) - L;
-   rdmV[idx] = 1.0/(N-1.0)*(T(k,k)+T(l,l)) + cos2sin2*(0.5*(V(k,k,k,k)+V(l,l,l,l))-3*V(k,k,l,l)+V(k,l,k,l))+(cos4+sin4)*(V(k,l,k,l)-0.5*V(k,k,l,l))+(cos3sin-cossin3)*(V(k,l,k,k)-V(k,l,l,l));
+   rdmV[idx] = 1.0/(N-1.0)*(ints.T(k,k)+ints.T(l,l)) + cos2sin2*(0.5*(ints.Vaabb(k,k)+ints.Vaabb(l,l))-3*ints.Vaabb(k,l)+ints.Vabab(k,l))+(cos4+sin4)*(ints.Vabab(k,l)-0.5*ints.Vaabb(k,l))+(cos3sin-cossin3)*(Vklaa[k]-Vklaa[l]);
 }
 
 void TPM::WriteFullToFile(std::string filename) const
@@ -22,6 +22,9 @@
  */
 
 #include <fstream>
+#include <algorithm>
+#include <memory>
+#include <cmath>
 #include <hdf5.h>
 #include "include.h"
 
@@ -108,8 +111,7 @@ void Tools::scan_all(const TPM &rdm, const CheMPS2::Hamiltonian &ham)
 {
    const int L = rdm.gL();
 
-   std::function<double(int,int)> getT = [&ham] (int a, int b) -> double { return ham.getTmat(a,b); };
-   std::function<double(int,int,int,int)> getV = [&ham]  (int a, int b, int c, int d) -> double { return ham.getVmat(a,b,c,d); };
+   const DociIntegrals ints(ham);
 
    PotentialReduction mymethod(ham);
    
@@ -128,7 +130,7 @@ void Tools::scan_all(const TPM &rdm, const CheMPS2::Hamiltonian &ham)
 
             fs << "# theta\trot\trot+v2dm" << std::endl;
 
-            auto found = rdm.find_min_angle(k_in,l_in,0.3,getT,getV);
+            auto found = rdm.find_min_angle(k_in,l_in,0.3,ints);
 
             std::cout << "Min:\t" << k_in << "\t" << l_in << "\t" << found.first << "\t" << found.second << std::endl;
 
@@ -143,7 +145,7 @@ void Tools::scan_all(const TPM &rdm, const CheMPS2::Hamiltonian &ham)
 
                mymethod.getHam() = orig_ham;
                mymethod.getRDM() = rdm;
-               mymethod.getHam().rotate(k_in, l_in, theta, getT, getV);
+               mymethod.getHam().rotate(k_in, l_in, theta, ints);
 
                double new_en = mymethod.evalEnergy();
 
@@ -157,62 +159,187 @@ void Tools::scan_all(const TPM &rdm, const CheMPS2::Hamiltonian &ham)
          }
 }
 
+/**
+ * Scan the energy (with the boundary point method) of a jacobi rotation of every orbital pair
+ * over [-pi/2,pi/2]. Every pair walks a coarse grid from theta = 0 to both ends, with every
+ * angle warm started from the solution at its neighbour. Every minimum on the grid is refined
+ * with a golden section search. The pairs run in parallel. For every pair the points are written
+ * to orbs-scan-k-l.txt in SAVE_H5_PATH.
+ * @param rdm the rdm for the estimated energy (the second column) and the minimum of TPM::find_min_angle
+ * @param ham the integrals to start from
+ */
 void Tools::scan_all_bp(const TPM &rdm, const CheMPS2::Hamiltonian &ham)
 {
    const int L = rdm.gL();
 
-   std::function<double(int,int)> getT = [&ham] (int a, int b) -> double { return ham.getTmat(a,b); };
-   std::function<double(int,int,int,int)> getV = [&ham]  (int a, int b, int c, int d) -> double { return ham.getVmat(a,b,c,d); };
+   const DociIntegrals ints(ham);
 
+   // the constraints are only built once: every pair works on a copy of this method
    BoundaryPoint method(ham);
+   method.set_tol_PD(1e-7);
+   method.set_output(false);
+
+   std::string logname = getenv("SAVE_H5_PATH");
+   logname += "/orbs-scan.log";
+   method.set_outfile(logname);
+
+   // the solution at theta = 0 is the start point of all the scans
+   method.Run();
+   method.set_use_prev_result(true);
 
    const auto orig_ham = method.getHam();
 
+   std::vector< std::pair<int,int> > pairs;
    for(int k_in=0;k_in<L;k_in++)
       for(int l_in=k_in+1;l_in<L;l_in++)
          if(ham.getOrbitalIrrep(k_in) == ham.getOrbitalIrrep(l_in))
+            pairs.push_back(std::make_pair(k_in,l_in));
+
+   // a coarse grid over [-pi/2,pi/2], every minimum on it is refined up to this width
+   const int Na = 24;
+   const double refine_width = 1e-3;
+
+#pragma omp parallel for schedule(dynamic)
+   for(int p=0;p<pairs.size();p++)
+   {
+      const int k_in = pairs[p].first;
+      const int l_in = pairs[p].second;
+
+      BoundaryPoint mymethod(method);
+
+      std::string filename = getenv("SAVE_H5_PATH");
+      filename += "/orbs-scan-" + std::to_string(k_in) + "-" + std::to_string(l_in);
+      mymethod.set_outfile(filename + ".log");
+
+      struct Point
+      {
+         double theta, rot, full;
+         std::unique_ptr<SUP> X, Z;
+      };
+
+      std::vector<Point> points;
+
+      // solve at theta, warm started from the solution at the nearest angle
+      auto solve = [&] (double theta) {
+         const Point *from = nullptr;
+
+         for(auto &pt: points)
+            if(!from || fabs(pt.theta-theta) < fabs(from->theta-theta))
+               from = &pt;
+
+         if(from)
          {
-            std::fstream fs;
-            std::string filename = getenv("SAVE_H5_PATH");
-            filename += "/orbs-scan-" + std::to_string(k_in) + "-" + std::to_string(l_in) + ".txt";
-            fs.open(filename, std::fstream::out | std::fstream::trunc);
+            mymethod.getX() = *from->X;
+            mymethod.getZ() = *from->Z;
+            mymethod.rotate(k_in, l_in, theta - from->theta);
+         }
 
-            fs.precision(10);
+         mymethod.getHam() = orig_ham;
+         mymethod.getHam().rotate(k_in, l_in, theta, ints);
 
-            fs << "# theta\trot\trot+v2dm" << std::endl;
+         mymethod.Run();
 
-            auto found = rdm.find_min_angle(k_in,l_in,0.3,getT,getV);
+         Point pt;
+         pt.theta = theta;
+         pt.rot = rdm.calc_rotate(k_in, l_in, theta, ints) + ham.getEconst();
+         pt.full = mymethod.evalEnergy();
+         pt.X.reset(new SUP(mymethod.getX()));
+         pt.Z.reset(new SUP(mymethod.getZ()));
 
-            std::cout << "Min:\t" << k_in << "\t" << l_in << "\t" << found.first << "\t" << found.second << std::endl;
+         points.push_back(std::move(pt));
 
-            std::cout << "######################" << std::endl;
+         return points.back().full;
+      };
 
+      // walk from theta = 0 to both ends
+      Point start;
+      start.theta = 0;
+      start.rot = rdm.calc_rotate(k_in, l_in, 0, ints) + ham.getEconst();
+      start.full = method.evalEnergy();
+      start.X.reset(new SUP(method.getX()));
+      start.Z.reset(new SUP(method.getZ()));
+      points.push_back(std::move(start));
 
-            int Na = 100;
-#pragma omp parallel for
-            for(int a=0;a<=Na;a++)
-            {
-               double theta = 1.0*M_PI/(1.0*Na) * a - M_PI/2.0;
+      for(int a=Na/2+1;a<=Na;a++)
+         solve(M_PI/(1.0*Na) * a - M_PI/2.0);
 
-               BoundaryPoint mymethod(ham);
-               mymethod.set_tol_PD(1e-7);
+      for(int a=Na/2-1;a>=0;a--)
+         solve(M_PI/(1.0*Na) * a - M_PI/2.0);
 
-//               mymethod.set_output(false);
+      std::sort(points.begin(), points.end(), [](const Point &x, const Point &y) { return x.theta < y.theta; });
 
-               mymethod.getHam() = orig_ham;
-               mymethod.getRDM() = rdm;
-               mymethod.getHam().rotate(k_in, l_in, theta, getT, getV);
+      std::vector< std::pair<double,double> > brackets;
+      for(int a=1;a<Na;a++)
+         if(points[a].full <= points[a-1].full && points[a].full <= points[a+1].full)
+            brackets.push_back(std::make_pair(points[a-1].theta, points[a+1].theta));
 
-               double new_en = mymethod.evalEnergy();
+      // golden section search in every bracket
+      const double golden = (std::sqrt(5.0)-1.0)/2.0;
+      double min_theta = 0;
+      double min_energy = points[Na/2].full;
 
-               mymethod.Run();
+      for(auto &br: brackets)
+      {
+         double lo = br.first;
+         double hi = br.second;
+         double x1 = hi - golden*(hi-lo);
+         double x2 = lo + golden*(hi-lo);
+         double f1 = solve(x1);
+         double f2 = solve(x2);
 
-#pragma omp critical
-               fs << theta << "\t" << new_en << "\t" << mymethod.evalEnergy() << std::endl;
+         while(hi-lo > refine_width)
+         {
+            if(f1 < f2)
+            {
+               hi = x2;
+               x2 = x1;
+               f2 = f1;
+               x1 = hi - golden*(hi-lo);
+               f1 = solve(x1);
             }
+            else
+            {
+               lo = x1;
+               x1 = x2;
+               f1 = f2;
+               x2 = lo + golden*(hi-lo);
+               f2 = solve(x2);
+            }
+         }
 
-            fs.close();
+         const double x = (f1 < f2) ? x1 : x2;
+         const double f = std::min(f1, f2);
+
+         if(f < min_energy)
+         {
+            min_energy = f;
+            min_theta = x;
          }
+      }
+
+      std::sort(points.begin(), points.end(), [](const Point &x, const Point &y) { return x.theta < y.theta; });
+
+      std::fstream fs;
+      fs.open(filename + ".txt", std::fstream::out | std::fstream::trunc);
+
+      fs.precision(10);
+
+      fs << "# theta\trot\trot+v2dm" << std::endl;
+
+      for(auto &pt: points)
+         fs << pt.theta << "\t" << pt.rot << "\t" << pt.full << std::endl;
+
+      fs.close();
+
+      auto found = rdm.find_min_angle(k_in,l_in,0.3,ints);
+
+#pragma omp critical
+      {
+         std::cout << "Min:\t" << k_in << "\t" << l_in << "\t" << found.first << "\t" << found.second << std::endl;
+         std::cout << "Min v2DM:\t" << k_in << "\t" << l_in << "\t" << min_theta << "\t" << min_energy << "\t(" << points.size() << " points)" << std::endl;
+         std::cout << "######################" << std::endl;
+      }
+   }
 }
 
 
@@ -36,6 +36,7 @@ using std::ifstream;
 
 #include "Vector.h"
 #include "lapack.h"
+#include "LinComb.h"
 
 using namespace doci2DM;
 
@@ -412,4 +413,13 @@ void Vector::sep_pm(Vector &pos, Vector &neg)
          pos[i] = vector[i];
 }
 
+/**
+ * Add the memory of this vector to the segment list
+ * @param seg the list to add to
+ */
+void Vector::segments(Segments &seg) const
+{
+   seg.add(vector.get(), n);
+}
+
 /* vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,142 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#include <assert.h>
+
+#include "Workspace.h"
+
+using namespace doci2DM;
+
+/**
+ * Allocate all the scratch objects
+ * @param L the number of levels
+ * @param N the number of particles
+ * @param n_tpm the number of TPM's to hold
+ * @param n_sup the number of SUP's to hold
+ * @param n_phm the number of PHM's to hold
+ * @param n_orb the number of orbital part arrays (2L doubles, see TPM::get_orbital_part) to hold
+ */
+Workspace::Workspace(int L, int N, int n_tpm, int n_sup, int n_phm, int n_orb)
+{
+   this->L = L;
+   this->N = N;
+
+   tpms.resize(n_tpm);
+   sups.resize(n_sup);
+   phms.resize(n_phm);
+
+   for(auto &tpm: tpms)
+      tpm.reset(new TPM(L,N));
+
+   for(auto &sup: sups)
+      sup.reset(new SUP(L,N));
+
+   for(auto &phm: phms)
+      phm.reset(new PHM(L,N));
+
+   orbs.resize(n_orb, std::vector<double>(2*L));
+
+   handed_out = 0;
+}
+
+/**
+ * Copying a Workspace gives a new Workspace of the same shape. The
+ * content of scratch space is meaningless, so it is not copied.
+ * @param orig the Workspace to take the shape from
+ */
+Workspace::Workspace(const Workspace &orig): Workspace(orig.L, orig.N, orig.tpms.size(), orig.sups.size(), orig.phms.size(), orig.orbs.size())
+{
+}
+
+/**
+ * @param i the slot to use
+ * @return the scratch TPM in slot i
+ */
+TPM& Workspace::getTPM(int i)
+{
+   assert(i < tpms.size());
+
+   ++handed_out;
+
+   return *tpms[i];
+}
+
+/**
+ * @param i the slot to use
+ * @return the scratch SUP in slot i
+ */
+SUP& Workspace::getSUP(int i)
+{
+   assert(i < sups.size());
+
+   ++handed_out;
+
+   return *sups[i];
+}
+
+/**
+ * @param i the slot to use
+ * @return the scratch PHM in slot i
+ */
+PHM& Workspace::getPHM(int i)
+{
+   assert(i < phms.size());
+
+   ++handed_out;
+
+   return *phms[i];
+}
+
+/**
+ * @param i the slot to use
+ * @return the scratch array of 2L doubles in slot i
+ */
+double* Workspace::getOrbital(int i)
+{
+   assert(i < orbs.size());
+
+   ++handed_out;
+
+   return orbs[i].data();
+}
+
+int Workspace::gL() const
+{
+   return L;
+}
+
+int Workspace::gN() const
+{
+   return N;
+}
+
+/**
+ * @return the number of times a scratch object was handed out, every
+ * getTPM/getSUP/getPHM/getOrbital call counts, not the number of slots
+ */
+unsigned long Workspace::gHandedOut() const
+{
+   return handed_out;
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -34,6 +34,7 @@
 #include "Hamiltonian.h"
 
 #include "SimulatedAnnealing.h"
+#include "OrbitalTransformMPI.h"
 
 sig_atomic_t stopping = 0;
 sig_atomic_t stopping_min = 0;
@@ -50,6 +51,9 @@ int main(int argc,char **argv)
    std::string integralsfile = "mo-integrals.h5";
    bool bp = false;
    bool pr = false;
+   bool delayed = false;
+   bool guided = false;
+   bool tempering = false;
    std::string startinput;
 
    struct option long_options[] =
@@ -58,13 +62,16 @@ int main(int argc,char **argv)
       {"start",  required_argument, 0, 's'},
       {"boundary-point",  no_argument, 0, 'b'},
       {"potential-reduction",  no_argument, 0, 'p'},
+      {"delayed-acceptance",  no_argument, 0, 'd'},
+      {"guided",  no_argument, 0, 'g'},
+      {"tempering",  no_argument, 0, 't'},
       {"help",  no_argument, 0, 'h'},
       {0, 0, 0, 0}
    };
 
    int i,j;
 
-   while( (j = getopt_long (argc, argv, "hi:bps:", long_options, &i)) != -1)
+   while( (j = getopt_long (argc, argv, "hi:bps:dgt", long_options, &i)) != -1)
       switch(j)
       {
          case 'h':
@@ -75,6 +82,9 @@ int main(int argc,char **argv)
                "    -b, --boundary-point            Use the boundary point method as solver (default)\n"
                "    -p, --potential-reduction       Use the potential reduction method as solver\n"
                "    -s, --start                     Use this a start point for the Simulated Annealing\n"
+               "    -d, --delayed-acceptance        Screen the moves with the estimated energy before solving the SDP\n"
+               "    -g, --guided                    Draw the moves from the energy landscape of the current 2DM\n"
+               "    -t, --tempering                 Parallel tempering: every MPI rank at a fixed temperature\n"
                "    -h, --help                      Display this help\n"
                "\n";
             return 0;
@@ -91,6 +101,15 @@ int main(int argc,char **argv)
          case 'p':
             pr = true;
             break;
+         case 'd':
+            delayed = true;
+            break;
+         case 'g':
+            guided = true;
+            break;
+         case 't':
+            tempering = true;
+            break;
       }
 
    if(!bp && !pr)
@@ -111,6 +130,9 @@ int main(int argc,char **argv)
 
    SimulatedAnnealing opt(CheMPS2::Hamiltonian::CreateFromH5(integralsfile));
 
+   // all ranks on a node share the original integrals
+   simanneal::share_original(opt.getOrbitalTf(), MPI_COMM_WORLD);
+
    if(bp)
       opt.UseBoundaryPoint();
    else if(pr)
@@ -128,6 +150,8 @@ int main(int argc,char **argv)
    opt.Set_delta_temp(0.99);
    opt.Set_max_angle(1.3);
    opt.Set_delta_angle(0.999);
+   opt.Set_delayed_acceptance(delayed);
+   opt.Set_guided_proposals(guided);
 
 //   opt.get_Optimal_Unitary().loadU("optimale-uni.h5");
 //   opt.calc_new_energy();
@@ -147,7 +171,10 @@ int main(int argc,char **argv)
    else
       opt.calc_energy();
 
-   opt.optimize_mpi();
+   if(tempering)
+      opt.optimize_pt();
+   else
+      opt.optimize_mpi();
 
    auto end = std::chrono::high_resolution_clock::now();
 
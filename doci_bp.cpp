@@ -23,6 +23,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cstring>
 #include <getopt.h>
 #include <signal.h>
@@ -30,6 +31,8 @@
 #include "include.h"
 #include "BoundaryPoint.h"
 #include "LocalMinimizer.h"
+#include "OrbitalOptimizer.h"
+#include "MultiStart.h"
 
 // from CheMPS2
 #include "Hamiltonian.h"
@@ -48,6 +51,8 @@ int main(int argc,char **argv)
    using std::endl;
    using namespace doci2DM;
    using simanneal::LocalMinimizer;
+   using simanneal::OrbitalOptimizer;
+   using simanneal::MultiStart;
 
    cout.precision(10);
 
@@ -58,6 +63,11 @@ int main(int argc,char **argv)
    bool localmini = false;
    bool scan = false;
    bool localmininoopt = false;
+   bool localminisweep = false;
+   bool orbopt = false;
+   int speculative = 0;
+   bool coupled = false;
+   int multistart = 0;
 
    struct option long_options[] =
    {
@@ -68,13 +78,18 @@ int main(int argc,char **argv)
       {"scan",  no_argument, 0, 's'},
       {"local-minimizer",  no_argument, 0, 'l'},
       {"local-minimizer-no-opt",  no_argument, 0, 'n'},
+      {"local-minimizer-sweep",  no_argument, 0, 'w'},
+      {"orbital-optimizer",  no_argument, 0, 'o'},
+      {"speculative",  required_argument, 0, 'k'},
+      {"coupled",  no_argument, 0, 'c'},
+      {"multi-start",  required_argument, 0, 'm'},
       {"help",  no_argument, 0, 'h'},
       {0, 0, 0, 0}
    };
 
    int i,j;
 
-   while( (j = getopt_long (argc, argv, "d:rlhi:u:sn", long_options, &i)) != -1)
+   while( (j = getopt_long (argc, argv, "d:rlhi:u:snwok:cm:", long_options, &i)) != -1)
       switch(j)
       {
          case 'h':
@@ -87,6 +102,11 @@ int main(int argc,char **argv)
                "    -r, --random                    Perform a random unitary transformation on the Hamiltonian\n"
                "    -l, --local-minimizer           Use the local minimizer\n"
                "    -n, --local-minimizer-no-opt    Use the local minimizer without optimalization\n"
+               "    -w, --local-minimizer-sweep     Use the local minimizer with sweeps of disjoint orbital pairs\n"
+               "    -o, --orbital-optimizer         Optimize all orbital rotations at once with L-BFGS steps\n"
+               "    -k, --speculative=nr            Use the local minimizer and verify the nr best rotations in parallel\n"
+               "    -c, --coupled                   Use the local minimizer with the SDP iterations interleaved\n"
+               "    -m, --multi-start=nr            Run the local minimizer from nr starting unitaries in threads\n"
                "    -h, --help                      Display this help\n"
                "\n";
             return 0;
@@ -112,6 +132,24 @@ int main(int argc,char **argv)
          case 'n':
             localmininoopt = true;
             break;
+         case 'w':
+            localmini = true;
+            localminisweep = true;
+            break;
+         case 'o':
+            orbopt = true;
+            break;
+         case 'k':
+            localmini = true;
+            speculative = atoi(optarg);
+            break;
+         case 'c':
+            localmini = true;
+            coupled = true;
+            break;
+         case 'm':
+            multistart = atoi(optarg);
+            break;
       }
 
    cout << "Reading: " << integralsfile << endl;
@@ -129,7 +167,7 @@ int main(int argc,char **argv)
 
    cout << "Starting with L=" << L << " N=" << N << endl;
 
-   if(!unitary.empty() && !localmini)
+   if(!unitary.empty() && !localmini && !orbopt && !multistart)
    {
       cout << "Reading transform: " << unitary << endl;
 
@@ -195,7 +233,47 @@ int main(int argc,char **argv)
       method.getRDM().ReadFromFile(rdmfile);
    }
 
-   if(localmini)
+   if(orbopt)
+   {
+      OrbitalOptimizer optimizer(ham);
+
+      if(!unitary.empty())
+      {
+         cout << "Starting orbital optimizer from: " << unitary << endl;
+         optimizer.getOrbitalTf().get_unitary().loadU(unitary);
+      }
+
+      optimizer.UseBoundaryPoint();
+      optimizer.getMethod_BP().getX() = method.getX();
+      optimizer.getMethod_BP().getZ() = method.getZ();
+      optimizer.getMethod_BP().set_use_prev_result(true);
+      optimizer.getMethod_BP().set_tol_PD(1e-7);
+
+      optimizer.Minimize();
+
+      cout << "Bottom is " << optimizer.get_energy() << endl;
+
+      method = optimizer.getMethod_BP();
+      ham = optimizer.getHam();
+   }
+   else if(multistart > 0)
+   {
+      MultiStart starts(ham, multistart);
+
+      starts.Run();
+
+      cout << "Bottom is " << starts.get_energy() << endl;
+
+      auto& best = starts.getBest();
+
+      std::stringstream h5_name;
+      h5_name << getenv("SAVE_H5_PATH") << "/optimale-uni.h5";
+      best.get_Optimal_Unitary().saveU(h5_name.str());
+
+      method = best.getMethod_BP();
+      ham = best.getHam();
+   }
+   else if(localmini)
    {
       LocalMinimizer minimize(ham);
 
@@ -218,6 +296,12 @@ int main(int argc,char **argv)
 
       if(localmininoopt)
          minimize.Minimize_noOpt(1e-2);
+      else if(localminisweep)
+         minimize.Minimize_sweep();
+      else if(speculative > 0)
+         minimize.Minimize_speculative(speculative);
+      else if(coupled)
+         minimize.Minimize_coupled();
       else
          minimize.Minimize();
 
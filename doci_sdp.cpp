@@ -28,6 +28,7 @@
 
 #include "include.h"
 #include "PotentialReducation.h"
+#include "InteriorPoint.h"
 #include "LocalMinimizer.h"
 
 // from CheMPS2
@@ -55,6 +56,7 @@ int main(int argc, char **argv)
    bool random = false;
    bool localmini = false;
    bool scan = false;
+   bool interior = false;
 
    struct option long_options[] =
    {
@@ -63,13 +65,14 @@ int main(int argc, char **argv)
       {"random",  no_argument, 0, 'r'},
       {"scan",  no_argument, 0, 's'},
       {"local-minimizer",  no_argument, 0, 'l'},
+      {"interior-point",  no_argument, 0, 'p'},
       {"help",  no_argument, 0, 'h'},
       {0, 0, 0, 0}
    };
 
    int i,j;
 
-   while( (j = getopt_long (argc, argv, "d:rlhi:u:s", long_options, &i)) != -1)
+   while( (j = getopt_long (argc, argv, "d:rlhi:u:sp", long_options, &i)) != -1)
       switch(j)
       {
          case 'h':
@@ -80,6 +83,7 @@ int main(int argc, char **argv)
                "    -u, --unitary=unitary-file      Use the unitary matrix in this file\n"
                "    -r, --random                    Perform a random unitary transformation on the Hamiltonian\n"
                "    -l, --local-minimizer           Use the local minimizer\n"
+               "    -p, --interior-point            Use the primal-dual interior point method instead of the potential reduction\n"
                "    -h, --help                      Display this help\n"
                "\n";
             return 0;
@@ -99,6 +103,9 @@ int main(int argc, char **argv)
          case 's':
             scan = true;
             break;
+         case 'p':
+            interior = true;
+            break;
       }
 
    cout << "Reading: " << integralsfile << endl;
@@ -142,7 +149,12 @@ int main(int argc, char **argv)
       orbtrans.fillHamCI(ham);
    }
 
-   PotentialReduction method(ham);
+   std::unique_ptr<Method> method;
+
+   if(interior)
+      method.reset(new InteriorPoint(ham));
+   else
+      method.reset(new PotentialReduction(ham));
 
    // set up everything to handle SIGALRM
    struct sigaction act;
@@ -169,7 +181,10 @@ int main(int argc, char **argv)
          minimize.getOrbitalTf().get_unitary().loadU(unitary);
       }
 
-      minimize.UsePotentialReduction();
+      if(interior)
+         minimize.UseInteriorPoint();
+      else
+         minimize.UsePotentialReduction();
 
       minimize.set_conv_crit(1e-6);
 
@@ -177,20 +192,20 @@ int main(int argc, char **argv)
 
       cout << "Bottom is " << minimize.get_energy() << endl;
 
-      method = minimize.getMethod_PR();
+      method.reset(minimize.getMethod().Clone());
       ham = minimize.getHam();
    } else
-      method.Run();
+      method->Run();
 
-   cout << "The optimal energy is " << method.evalEnergy() << std::endl;
+   cout << "The optimal energy is " << method->evalEnergy() << std::endl;
 
    if(scan)
-      Tools::scan_all(method.getRDM(), ham);
+      Tools::scan_all(method->getRDM(), ham);
 
    std::string h5_name = getenv("SAVE_H5_PATH");
    h5_name += "/optimal-rdm.h5";
 
-   method.getRDM().WriteToFile(h5_name);
+   method->getRDM().WriteToFile(h5_name);
 
    h5_name = getenv("SAVE_H5_PATH");
    h5_name += "/optimal-ham.h5";
@@ -33,125 +33,109 @@ using namespace std;
 CheMPS2::FourIndex::FourIndex(const int nGroup, const int * IrrepSizes){
 
    SymmInfo.setGroup(nGroup);
+   numIrreps = SymmInfo.getNumberOfIrreps();
    
-   Isizes = new int[SymmInfo.getNumberOfIrreps()];
-   storage = new long long****[SymmInfo.getNumberOfIrreps()];
+   Isizes.assign(IrrepSizes, IrrepSizes + numIrreps);
    
-   for (int Icenter=0; Icenter<SymmInfo.getNumberOfIrreps(); Icenter++){
-      Isizes[Icenter] = IrrepSizes[Icenter];
-   }
-   
-   arrayLength = calcNumberOfUniqueElements(true); //true means allocate the storage!
+   arrayLength = calcNumberOfUniqueElements();
    theElements = new double[arrayLength];
+   ownsElements = true;
    
 }
 
 CheMPS2::FourIndex::FourIndex(const CheMPS2::FourIndex &orig)
 {
    SymmInfo = orig.SymmInfo;
+   numIrreps = orig.numIrreps;
    
-   Isizes = new int[SymmInfo.getNumberOfIrreps()];
-   storage = new long long****[SymmInfo.getNumberOfIrreps()];
-   
-   memcpy(Isizes, orig.Isizes, sizeof(int)*SymmInfo.getNumberOfIrreps());
+   Isizes = orig.Isizes;
+   blockStart = orig.blockStart;
+   rowStart = orig.rowStart;
+   offsets = orig.offsets;
    
-   arrayLength = calcNumberOfUniqueElements(true); //true means allocate the storage!
+   arrayLength = orig.arrayLength;
    theElements = new double[arrayLength];
+   ownsElements = true;
 
    memcpy(theElements, orig.theElements, sizeof(double)*arrayLength);
 }
 
-long long CheMPS2::FourIndex::calcNumberOfUniqueElements(const bool allocate){
+long long CheMPS2::FourIndex::calcNumberOfUniqueElements(){
 
    //The object size: see text above storage in Fourindex.h
    long long theTotalSize = 0;
+
+   blockStart.assign(numIrreps*numIrreps*numIrreps, -1);
+   rowStart.clear();
+   offsets.clear();
+
+   //Start a new row of the current block, the entries are added in order of j
+   auto newRow = [&] (const long long block, const int row){ rowStart[block + row] = offsets.size(); };
    
-   for (int Icenter=0; Icenter<SymmInfo.getNumberOfIrreps(); Icenter++){
-      if (allocate){ storage[Icenter] = new long long***[SymmInfo.getNumberOfIrreps()]; }
-      for (int I_i=0; I_i<SymmInfo.getNumberOfIrreps(); I_i++){
+   for (int Icenter=0; Icenter<numIrreps; Icenter++){
+      for (int I_i=0; I_i<numIrreps; I_i++){
          int I_j = Irreps::directProd(Icenter,I_i);
          if ((Isizes[I_i]>0)&&(Isizes[I_j]>0)){
-            if (allocate){ storage[Icenter][I_i] = new long long**[SymmInfo.getNumberOfIrreps()]; }
-            for (int I_k=I_i; I_k<SymmInfo.getNumberOfIrreps(); I_k++){
+            for (int I_k=I_i; I_k<numIrreps; I_k++){
                int I_l = Irreps::directProd(Icenter,I_k);
                if ((Isizes[I_k]>0)&&(Isizes[I_l]>0)){
                   if ((I_i <= I_j) && (I_j <= I_l)){
+                     const long long block = rowStart.size();
+                     blockStart[(Icenter*numIrreps + I_i)*numIrreps + I_k] = block;
                      if (Icenter == 0){ // I_i = I_j and I_k = I_l
                         if (I_i == I_k){
-                           if (allocate){ storage[Icenter][I_i][I_k] = new long long*[Isizes[I_i]*(Isizes[I_i]+1)/2]; }
+                           rowStart.resize(block + Isizes[I_i]*(Isizes[I_i]+1)/2);
                            for (int i=0; i<Isizes[I_i]; i++){
                               for (int k=i; k<Isizes[I_k]; k++){
-                                 if (allocate){
-                                    storage[Icenter][I_i][I_k][i + k*(k+1)/2] = new long long[Isizes[I_j]-i]; 
-                                    for (int j=i; j<Isizes[I_j]; j++){
-                                       storage[Icenter][I_i][I_k][i + k*(k+1)/2][j-i] = theTotalSize;
-                                       theTotalSize += Isizes[I_l] - ((i==j) ? k : j);
-                                    }
-                                 } else {
-                                    delete [] storage[Icenter][I_i][I_k][i + k*(k+1)/2];
+                                 newRow(block, i + k*(k+1)/2);
+                                 for (int j=i; j<Isizes[I_j]; j++){
+                                    offsets.push_back(theTotalSize);
+                                    theTotalSize += Isizes[I_l] - ((i==j) ? k : j);
                                  }
                               }
                            }
-                           if (!allocate){ delete [] storage[Icenter][I_i][I_k]; }
                         } else { // I_i < I_k
-                           if (allocate){ storage[Icenter][I_i][I_k] = new long long*[Isizes[I_i]*Isizes[I_k]]; }
+                           rowStart.resize(block + Isizes[I_i]*Isizes[I_k]);
                            for (int i=0; i<Isizes[I_i]; i++){
                               for (int k=0; k<Isizes[I_k]; k++){
-                                 if (allocate){
-                                    storage[Icenter][I_i][I_k][i + k*Isizes[I_i]] = new long long[Isizes[I_j]-i];
-                                    for (int j=i; j<Isizes[I_j]; j++){
-                                       storage[Icenter][I_i][I_k][i+k*Isizes[I_i]][j-i] = theTotalSize;
-                                       theTotalSize += Isizes[I_l] - ((i==j) ? k : 0 );
-                                    }
-                                 } else {
-                                    delete [] storage[Icenter][I_i][I_k][i + k*Isizes[I_i]];
+                                 newRow(block, i + k*Isizes[I_i]);
+                                 for (int j=i; j<Isizes[I_j]; j++){
+                                    offsets.push_back(theTotalSize);
+                                    theTotalSize += Isizes[I_l] - ((i==j) ? k : 0 );
                                  }
                               }
                            }
-                           if (!allocate){ delete [] storage[Icenter][I_i][I_k]; }
                         }
                      } else { //Icenter !=0 ; I_i < I_j and I_k != I_l
                         if (I_i == I_k){
-                           if (allocate){ storage[Icenter][I_i][I_k] = new long long*[Isizes[I_i]*(Isizes[I_i]+1)/2]; }
+                           rowStart.resize(block + Isizes[I_i]*(Isizes[I_i]+1)/2);
                            for (int i=0; i<Isizes[I_i]; i++){
                               for (int k=i; k<Isizes[I_k]; k++){
-                                 if (allocate){
-                                    storage[Icenter][I_i][I_k][i + k*(k+1)/2] = new long long[Isizes[I_j]];
-                                    for (int j=0; j<Isizes[I_j]; j++){
-                                       storage[Icenter][I_i][I_k][i + k*(k+1)/2][j] = theTotalSize;
-                                       theTotalSize += Isizes[I_l] - j;
-                                    }
-                                 } else {
-                                    delete [] storage[Icenter][I_i][I_k][i + k*(k+1)/2];
+                                 newRow(block, i + k*(k+1)/2);
+                                 for (int j=0; j<Isizes[I_j]; j++){
+                                    offsets.push_back(theTotalSize);
+                                    theTotalSize += Isizes[I_l] - j;
                                  }
                               }
                            }
-                           if (!allocate){ delete [] storage[Icenter][I_i][I_k]; }
                         } else { // I_i < I_k
-                           if (allocate){ storage[Icenter][I_i][I_k] = new long long*[Isizes[I_i]*Isizes[I_k]]; }
+                           rowStart.resize(block + Isizes[I_i]*Isizes[I_k]);
                            for (int i=0; i<Isizes[I_i]; i++){
                               for (int k=0; k<Isizes[I_k]; k++){
-                                 if (allocate){
-                                    storage[Icenter][I_i][I_k][i + k*Isizes[I_i]] = new long long[Isizes[I_j]];
-                                    for (int j=0; j<Isizes[I_j]; j++){
-                                       storage[Icenter][I_i][I_k][i + k*Isizes[I_i]][j] = theTotalSize;
-                                       theTotalSize += Isizes[I_l];
-                                    }
-                                 } else {
-                                    delete [] storage[Icenter][I_i][I_k][i + k*Isizes[I_i]];
+                                 newRow(block, i + k*Isizes[I_i]);
+                                 for (int j=0; j<Isizes[I_j]; j++){
+                                    offsets.push_back(theTotalSize);
+                                    theTotalSize += Isizes[I_l];
                                  }
                               }
                            }
-                           if (!allocate){ delete [] storage[Icenter][I_i][I_k]; }
                         }
                      }
                   }
                }
             }
-            if (!allocate){ delete [] storage[Icenter][I_i]; }
          }
       }
-      if (!allocate){ delete [] storage[Icenter]; }
    }
    
    return theTotalSize;
@@ -160,13 +144,24 @@ long long CheMPS2::FourIndex::calcNumberOfUniqueElements(const bool allocate){
 
 CheMPS2::FourIndex::~FourIndex(){
    
-   arrayLength = calcNumberOfUniqueElements(false); //false means delete the storage!
-   delete [] theElements;
-   delete [] Isizes;
-   delete [] storage;
+   if (ownsElements)
+      delete [] theElements;
    
 }
 
+void CheMPS2::FourIndex::useExternalStorage(double * storage, const bool copy){
+
+   if (copy)
+      memcpy(storage, theElements, sizeof(double)*arrayLength);
+
+   if (ownsElements)
+      delete [] theElements;
+
+   theElements = storage;
+   ownsElements = false;
+
+}
+
 void CheMPS2::FourIndex::set(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const int i, const int j, const int k, const int l, const double val){
 
    theElements[getPointer(irrep_i, irrep_j, irrep_k, irrep_l, i, j, k, l)] = val;
@@ -187,46 +182,170 @@ double CheMPS2::FourIndex::get(const int irrep_i, const int irrep_j, const int i
 
 long long CheMPS2::FourIndex::getPointer(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const int i, const int j, const int k, const int l) const {
 
+   //C1 (or all orbitals in one irrep): the irrep ordering is always OK
+   if (numIrreps == 1){
+      return getPtrIrrepOrderOK(0,0,0,0,i,j,k,l);
+   }
+
+   const int ordering = getIrrepOrdering(irrep_i,irrep_j,irrep_k,irrep_l);
+
+   if (ordering < 0){
+      return -1;
+   }
+
+   return getPtrOrdering(ordering,irrep_i,irrep_j,irrep_k,irrep_l,i,j,k,l);
+
+}
+
+/* Which one of the 8 permutations brings the irreps in the stored order. This only
+   depends on the irreps, so it can be done once for a whole block. Returns -1 if the
+   element is zero by symmetry. */
+int CheMPS2::FourIndex::getIrrepOrdering(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l) const {
+
    if (Irreps::directProd(irrep_i,irrep_j)==Irreps::directProd(irrep_k,irrep_l)){
 
-      if ((irrep_i <= irrep_j) && (irrep_i <= irrep_k) && (irrep_j <= irrep_l)){ // (ijkl irrep ordering)
+      if ((irrep_i <= irrep_j) && (irrep_i <= irrep_k) && (irrep_j <= irrep_l)) return 0; // (ijkl irrep ordering)
+      if ((irrep_j <= irrep_i) && (irrep_j <= irrep_l) && (irrep_i <= irrep_k)) return 1; // (jilk irrep ordering)
+      if ((irrep_k <= irrep_j) && (irrep_k <= irrep_i) && (irrep_j <= irrep_l)) return 2; // (kjil irrep ordering)
+      if ((irrep_j <= irrep_k) && (irrep_j <= irrep_l) && (irrep_k <= irrep_i)) return 3; // (jkli irrep ordering)
+      if ((irrep_i <= irrep_l) && (irrep_i <= irrep_k) && (irrep_l <= irrep_j)) return 4; // (ilkj irrep ordering)
+      if ((irrep_l <= irrep_i) && (irrep_l <= irrep_j) && (irrep_i <= irrep_k)) return 5; // (lijk irrep ordering)
+      if ((irrep_k <= irrep_l) && (irrep_k <= irrep_i) && (irrep_l <= irrep_j)) return 6; // (klij irrep ordering)
+      if ((irrep_l <= irrep_k) && (irrep_l <= irrep_j) && (irrep_k <= irrep_i)) return 7; // (lkji irrep ordering)
+
+   }
+
+   return -1;
+
+}
+
+long long CheMPS2::FourIndex::getPtrOrdering(const int ordering, const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const int i, const int j, const int k, const int l) const {
+
+   switch (ordering){
+      case 0:
          return getPtrIrrepOrderOK(irrep_i,irrep_j,irrep_k,irrep_l,i,j,k,l);
-      }
-   
-      if ((irrep_j <= irrep_i) && (irrep_j <= irrep_l) && (irrep_i <= irrep_k)){ // (jilk irrep ordering)
+      case 1:
          return getPtrIrrepOrderOK(irrep_j,irrep_i,irrep_l,irrep_k,j,i,l,k);
-      }
-      
-      if ((irrep_k <= irrep_j) && (irrep_k <= irrep_i) && (irrep_j <= irrep_l)){ // (kjil irrep ordering)
+      case 2:
          return getPtrIrrepOrderOK(irrep_k,irrep_j,irrep_i,irrep_l,k,j,i,l);
-      }   
-      
-      if ((irrep_j <= irrep_k) && (irrep_j <= irrep_l) && (irrep_k <= irrep_i)){ // (jkli irrep ordering)
+      case 3:
          return getPtrIrrepOrderOK(irrep_j,irrep_k,irrep_l,irrep_i,j,k,l,i);
-      }   
-      
-      if ((irrep_i <= irrep_l) && (irrep_i <= irrep_k) && (irrep_l <= irrep_j)){ // (ilkj irrep ordering)
+      case 4:
          return getPtrIrrepOrderOK(irrep_i,irrep_l,irrep_k,irrep_j,i,l,k,j);
-      }   
-      
-      if ((irrep_l <= irrep_i) && (irrep_l <= irrep_j) && (irrep_i <= irrep_k)){ // (lijk irrep ordering)
+      case 5:
          return getPtrIrrepOrderOK(irrep_l,irrep_i,irrep_j,irrep_k,l,i,j,k);
-      }   
-      
-      if ((irrep_k <= irrep_l) && (irrep_k <= irrep_i) && (irrep_l <= irrep_j)){ // (klij irrep ordering)
+      case 6:
          return getPtrIrrepOrderOK(irrep_k,irrep_l,irrep_i,irrep_j,k,l,i,j);
-      }   
-      
-      if ((irrep_l <= irrep_k) && (irrep_l <= irrep_j) && (irrep_k <= irrep_i)){ // (lkji irrep ordering)
+      case 7:
          return getPtrIrrepOrderOK(irrep_l,irrep_k,irrep_j,irrep_i,l,k,j,i);
-      }
-        
    }
-   
+
    return -1;
 
 }
 
+void CheMPS2::FourIndex::gatherBlock(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, double * dst) const {
+
+   const int ordering = getIrrepOrdering(irrep_i,irrep_j,irrep_k,irrep_l);
+   assert( ordering >= 0 );
+
+   const int size_i = Isizes[irrep_i];
+   const int size_j = Isizes[irrep_j];
+   const int size_k = Isizes[irrep_k];
+   const int size_l = Isizes[irrep_l];
+
+   for (int l=0; l<size_l; l++){
+      for (int k=0; k<size_k; k++){
+         for (int j=0; j<size_j; j++){
+            double * col = dst + size_i * (j + size_j * (k + size_k * l));
+            if (numIrreps == 1){
+               for (int i=0; i<size_i; i++){
+                  col[i] = theElements[getPtrIrrepOrderOK(0,0,0,0,i,j,k,l)];
+               }
+            } else {
+               for (int i=0; i<size_i; i++){
+                  col[i] = theElements[getPtrOrdering(ordering,irrep_i,irrep_j,irrep_k,irrep_l,i,j,k,l)];
+               }
+            }
+         }
+      }
+   }
+
+}
+
+void CheMPS2::FourIndex::scatterBlock(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const double * src){
+
+   const int ordering = getIrrepOrdering(irrep_i,irrep_j,irrep_k,irrep_l);
+   assert( ordering >= 0 );
+
+   const int size_i = Isizes[irrep_i];
+   const int size_j = Isizes[irrep_j];
+   const int size_k = Isizes[irrep_k];
+   const int size_l = Isizes[irrep_l];
+
+   for (int l=0; l<size_l; l++){
+      for (int k=0; k<size_k; k++){
+         for (int j=0; j<size_j; j++){
+            const double * col = src + size_i * (j + size_j * (k + size_k * l));
+            if (numIrreps == 1){
+               for (int i=0; i<size_i; i++){
+                  theElements[getPtrIrrepOrderOK(0,0,0,0,i,j,k,l)] = col[i];
+               }
+            } else {
+               for (int i=0; i<size_i; i++){
+                  theElements[getPtrOrdering(ordering,irrep_i,irrep_j,irrep_k,irrep_l,i,j,k,l)] = col[i];
+               }
+            }
+         }
+      }
+   }
+
+}
+
+void CheMPS2::FourIndex::gatherPairBlock(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, double * dst) const {
+
+   const int ordering = getIrrepOrdering(irrep_i,irrep_j,irrep_k,irrep_l);
+   assert( ordering >= 0 );
+
+   const bool packed_ik = (irrep_i == irrep_k);
+   const bool packed_jl = (irrep_j == irrep_l);
+   const int size_P = getPairSize(irrep_i,irrep_k);
+
+   for (int l=0; l<Isizes[irrep_l]; l++){
+      for (int j=(packed_jl ? l : 0); j<Isizes[irrep_j]; j++){
+         double * col = dst + size_P * getPairIndex(packed_jl,Isizes[irrep_j],j,l);
+         for (int k=0; k<Isizes[irrep_k]; k++){
+            for (int i=(packed_ik ? k : 0); i<Isizes[irrep_i]; i++){
+               col[getPairIndex(packed_ik,Isizes[irrep_i],i,k)] = theElements[getPtrOrdering(ordering,irrep_i,irrep_j,irrep_k,irrep_l,i,j,k,l)];
+            }
+         }
+      }
+   }
+
+}
+
+void CheMPS2::FourIndex::scatterPairBlock(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const double * src){
+
+   const int ordering = getIrrepOrdering(irrep_i,irrep_j,irrep_k,irrep_l);
+   assert( ordering >= 0 );
+
+   const bool packed_ik = (irrep_i == irrep_k);
+   const bool packed_jl = (irrep_j == irrep_l);
+   const int size_P = getPairSize(irrep_i,irrep_k);
+
+   for (int l=0; l<Isizes[irrep_l]; l++){
+      for (int j=(packed_jl ? l : 0); j<Isizes[irrep_j]; j++){
+         const double * col = src + size_P * getPairIndex(packed_jl,Isizes[irrep_j],j,l);
+         for (int k=0; k<Isizes[irrep_k]; k++){
+            for (int i=(packed_ik ? k : 0); i<Isizes[irrep_i]; i++){
+               theElements[getPtrOrdering(ordering,irrep_i,irrep_j,irrep_k,irrep_l,i,j,k,l)] = col[getPairIndex(packed_ik,Isizes[irrep_i],i,k)];
+            }
+         }
+      }
+   }
+
+}
+
 long long CheMPS2::FourIndex::getPtrIrrepOrderOK(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const int i, const int j, const int k, const int l) const {
 
    //I_i <= I_j <= I_l and I_i <= I_k
@@ -304,17 +423,17 @@ long long CheMPS2::FourIndex::getPtrAllOK(const int number, const int Icent, con
 
    switch (number){
       case 1:
-         return storage[Icent][irrep_i][irrep_k][i + k*(k+1)/2][j-i] + l-k;
+         return storage(Icent, irrep_i, irrep_k, i + k*(k+1)/2, j-i) + l-k;
       case 2:
-         return storage[Icent][irrep_i][irrep_k][i + k*(k+1)/2][j-i] + l-j;
+         return storage(Icent, irrep_i, irrep_k, i + k*(k+1)/2, j-i) + l-j;
       case 3:
-         return storage[Icent][irrep_i][irrep_k][i + Isizes[irrep_i]*k][j-i] + l-k;
+         return storage(Icent, irrep_i, irrep_k, i + Isizes[irrep_i]*k, j-i) + l-k;
       case 4:
-         return storage[Icent][irrep_i][irrep_k][i + Isizes[irrep_i]*k][j-i] + l;
+         return storage(Icent, irrep_i, irrep_k, i + Isizes[irrep_i]*k, j-i) + l;
       case 5:
-         return storage[Icent][irrep_i][irrep_k][i + k*(k+1)/2][j] + l-j;
+         return storage(Icent, irrep_i, irrep_k, i + k*(k+1)/2, j) + l-j;
       case 6:
-         return storage[Icent][irrep_i][irrep_k][i + Isizes[irrep_i]*k][j] + l;
+         return storage(Icent, irrep_i, irrep_k, i + Isizes[irrep_i]*k, j) + l;
    }
    
    return -1;
@@ -333,7 +452,7 @@ void CheMPS2::FourIndex::save(const std::string name) const{
          hsize_t dimarray       = SymmInfo.getNumberOfIrreps();
          hid_t dataspace_id     = H5Screate_simple(1, &dimarray, NULL);
          hid_t dataset_id       = H5Dcreate(group_id, "IrrepSizes", H5T_STD_I32LE, dataspace_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-         H5Dwrite(dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, Isizes);
+         H5Dwrite(dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, Isizes.data());
     
             //Attributes
             hid_t attribute_space_id1  = H5Screate(H5S_SCALAR);
@@ -394,7 +513,7 @@ void CheMPS2::FourIndex::save2(const std::string name) const
    hsize_t dimarray       = SymmInfo.getNumberOfIrreps();
    hid_t dataspace_id     = H5Screate_simple(1, &dimarray, NULL);
    hid_t dataset_id       = H5Dcreate(group_id, "IrrepSizes", H5T_STD_I32LE, dataspace_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-   H5Dwrite(dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, Isizes);
+   H5Dwrite(dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, Isizes.data());
 
    //Attributes
    hid_t attribute_space_id1  = H5Screate(H5S_SCALAR);
@@ -184,6 +184,52 @@ double CheMPS2::Hamiltonian::getVmat(const int index1, const int index2, const i
    
 }
 
+void CheMPS2::Hamiltonian::gatherVmatBlock(const int irrep1, const int irrep2, const int irrep3, const int irrep4, double * dst) const{
+
+   assert( Irreps::directProd(irrep1,irrep2) == Irreps::directProd(irrep3,irrep4) );
+   Vmat->gatherBlock(irrep1, irrep2, irrep3, irrep4, dst);
+
+}
+
+void CheMPS2::Hamiltonian::scatterVmatBlock(const int irrep1, const int irrep2, const int irrep3, const int irrep4, const double * src){
+
+   assert( Irreps::directProd(irrep1,irrep2) == Irreps::directProd(irrep3,irrep4) );
+   Vmat->scatterBlock(irrep1, irrep2, irrep3, irrep4, src);
+
+}
+
+void CheMPS2::Hamiltonian::gatherVmatPairBlock(const int irrep1, const int irrep2, const int irrep3, const int irrep4, double * dst) const{
+
+   assert( Irreps::directProd(irrep1,irrep2) == Irreps::directProd(irrep3,irrep4) );
+   Vmat->gatherPairBlock(irrep1, irrep2, irrep3, irrep4, dst);
+
+}
+
+void CheMPS2::Hamiltonian::scatterVmatPairBlock(const int irrep1, const int irrep2, const int irrep3, const int irrep4, const double * src){
+
+   assert( Irreps::directProd(irrep1,irrep2) == Irreps::directProd(irrep3,irrep4) );
+   Vmat->scatterPairBlock(irrep1, irrep2, irrep3, irrep4, src);
+
+}
+
+long long CheMPS2::Hamiltonian::getVmatLength() const{
+
+   return Vmat->getArrayLength();
+
+}
+
+double * CheMPS2::Hamiltonian::getVmatStorage(){
+
+   return Vmat->getStorage();
+
+}
+
+void CheMPS2::Hamiltonian::useExternalVmat(double * storage, const bool copy){
+
+   Vmat->useExternalStorage(storage, copy);
+
+}
+
 void CheMPS2::Hamiltonian::save(const string file_parent, const string file_tmat, const string file_vmat) const{
 
    Tmat->save(file_tmat);
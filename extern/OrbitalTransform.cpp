@@ -20,12 +20,21 @@
 #include <iostream>
 #include <cassert>
 #include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "OrbitalTransform.h"
 #include "Hamiltonian.h" 
 #include "OptIndex.h"
 #include "UnitaryMatrix.h"
 #include "Lapack.h"
+#include "FourIndex.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using std::min;
 using std::max;
@@ -40,8 +49,44 @@ OrbitalTransform::OrbitalTransform(const Hamiltonian& HamIn):
     SymmInfo.setGroup(HamIn.getNGroup());
     _hamorig.reset(new CheMPS2::Hamiltonian(HamIn));
 
+    shared_vmat = nullptr;
+    shared_length = 0;
+
     _unitary.reset(new UnitaryMatrix(index));
 
+    //All irrep blocks of the two-body terms --> use eightfold permutation symmetry in the irreps :-)
+    //A block (irrep1 irrep2 | irrep3 irrep4) is stored packed in the pairs (irrep1,irrep3) and (irrep2,irrep4)
+    max_block_size = 0;
+    std::vector<unsigned long long> cost;
+    for (int irrep1 = 0; irrep1<numberOfIrreps; irrep1++)
+        for (int irrep2 = irrep1; irrep2<numberOfIrreps; irrep2++)
+        {
+            const int productSymm = SymmInfo.directProd(irrep1,irrep2);
+            for (int irrep3 = irrep1; irrep3<numberOfIrreps; irrep3++)
+            {
+                const int irrep4 = SymmInfo.directProd(productSymm,irrep3);
+                // Generated all possible combinations of allowed irreps
+                if (irrep4>=irrep2)
+                {
+                    unsigned long long linsize1 = index.getNORB(irrep1);
+                    unsigned long long linsize2 = index.getNORB(irrep2);
+                    unsigned long long linsize3 = index.getNORB(irrep3);
+                    unsigned long long linsize4 = index.getNORB(irrep4);
+
+                    if (linsize1 * linsize2 * linsize3 * linsize4 > 0)
+                    {
+                        const unsigned long long pairs13 = (irrep1 == irrep3) ? linsize1*(linsize1+1)/2 : linsize1*linsize3;
+                        const unsigned long long pairs24 = (irrep2 == irrep4) ? linsize2*(linsize2+1)/2 : linsize2*linsize4;
+
+                        irrep_blocks.push_back({{irrep1, irrep2, irrep3, irrep4}});
+                        // every pair transformation is two matrix products
+                        cost.push_back(pairs24 * linsize1 * linsize3 * (linsize1 + linsize3) + pairs13 * linsize2 * linsize4 * (linsize2 + linsize4));
+                        max_block_size = max(max_block_size, pairs13 * pairs24);
+                    }
+                }
+            }
+        }
+
     //Create the memory for the orbital transformations.
     unsigned long long maxlinsize = 0;
     for (int irrep=0; irrep< index.getNirreps(); irrep++)
@@ -51,14 +96,111 @@ OrbitalTransform::OrbitalTransform(const Hamiltonian& HamIn):
             maxlinsize  = linsize_irrep;
     }
 
-    //Determine the blocksize for the 2-body transformation
-    auto& maxBlockSize = maxlinsize;
-    //Allocate 2-body rotation memory: One array is approx (maxBlockSize/273.0)^4 * 42 GiB --> [maxBlockSize=100 --> 750 MB]
-    auto maxBSpower4 = maxBlockSize * maxBlockSize * maxBlockSize * maxBlockSize; //Note that 273**4 overfloats the 32 bit integer!!!
-    auto sizeWorkmem1 = max( max( maxBSpower4 , 3*maxlinsize*maxlinsize ) , 1uLL * L * L ); //For (2-body tfo , updateUnitary, calcNOON)
-    auto sizeWorkmem2 = max( max( maxBSpower4 , 2*maxlinsize*maxlinsize ) , L*(L + 1uLL) ); //For (2-body tfo, updateUnitary and rotate_to_active_space, rotate2DMand1DM)
+    //The packed 2-body block is approx maxBlockSize^4/4 doubles --> [maxBlockSize=100 --> 200 MB]
+    auto sizeWorkmem1 = max( max( max_block_size , 4*maxlinsize*maxlinsize ) , 1uLL * L * L ); //For (2-body tfo , updateUnitary, calcNOON)
+    auto sizeWorkmem2 = max( 4*maxlinsize*maxlinsize , L*(L + 1uLL) ); //For (updateUnitary and rotate_to_active_space, rotate2DMand1DM)
     mem1.reset(new double[sizeWorkmem1]);
     mem2.reset(new double[sizeWorkmem2]);
+
+    // most expensive blocks first
+    std::vector<int> order(irrep_blocks.size());
+    for(unsigned int i=0;i<order.size();i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&cost](int a, int b) { return cost[a] > cost[b]; });
+
+    std::vector< std::array<int,4> > sorted_blocks;
+    for(auto i: order)
+        sorted_blocks.push_back(irrep_blocks[i]);
+    irrep_blocks = std::move(sorted_blocks);
+}
+
+OrbitalTransform::~OrbitalTransform()
+{
+    if (shared_vmat)
+        munmap(shared_vmat, shared_length);
+}
+
+/**
+ * Create the POSIX shared memory object name, copy the two-body terms of the
+ * original hamiltonian in it and use that (read only) copy from now on.
+ * See share_original(OrbitalTransform &, MPI_Comm) in OrbitalTransformMPI.h.
+ * @param name the name of the shared memory object, it should not exist yet
+ * @return true if the original hamiltonian now uses the shared copy
+ */
+bool OrbitalTransform::create_shared_original(const std::string &name)
+{
+    assert(!shared_vmat);
+
+    const size_t length = sizeof(double) * _hamorig->getVmatLength();
+
+    void * mapping = MAP_FAILED;
+
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+    if (fd >= 0)
+    {
+        if (ftruncate(fd, length) == 0)
+            mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+
+    if (mapping == MAP_FAILED)
+        return false;
+
+    _hamorig->useExternalVmat(static_cast<double *>(mapping), true);
+    mprotect(mapping, length, PROT_READ);
+
+    shared_vmat = mapping;
+    shared_length = length;
+
+    return true;
+}
+
+/**
+ * Map the POSIX shared memory object name (made by create_shared_original
+ * in another process) and use it instead of our own copy of the two-body terms.
+ * @param name the name of the shared memory object
+ * @return true if the original hamiltonian now uses the shared copy
+ */
+bool OrbitalTransform::attach_shared_original(const std::string &name)
+{
+    assert(!shared_vmat);
+
+    const size_t length = sizeof(double) * _hamorig->getVmatLength();
+
+    void * mapping = MAP_FAILED;
+
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+
+    if (fd >= 0)
+    {
+        mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+
+    if (mapping == MAP_FAILED)
+        return false;
+
+    _hamorig->useExternalVmat(static_cast<double *>(mapping), false);
+
+    shared_vmat = mapping;
+    shared_length = length;
+
+    return true;
+}
+
+/**
+ * Use the two-body terms of the original hamiltonian of owner instead of
+ * our own copy (for objects in the same process). Both should have the same
+ * original hamiltonian, and owner should outlive this object.
+ * @param owner the OrbitalTransform that keeps the two-body terms
+ */
+void OrbitalTransform::share_original(OrbitalTransform &owner)
+{
+    assert(_hamorig->getVmatLength() == owner._hamorig->getVmatLength());
+
+    if (&owner != this)
+        _hamorig->useExternalVmat(owner._hamorig->getVmatStorage(), false);
 }
 
 void OrbitalTransform::fillHamCI(Hamiltonian& HamCI)
@@ -67,68 +209,146 @@ void OrbitalTransform::fillHamCI(Hamiltonian& HamCI)
     buildOneBodyMatrixElements();	
     fillConstAndTmat(HamCI); //fill one body terms and constant part.	
 
-    //Two-body terms --> use eightfold permutation symmetry in the irreps :-)
-    for (int irrep1 = 0; irrep1<numberOfIrreps; irrep1++)
-        for (int irrep2 = irrep1; irrep2<numberOfIrreps; irrep2++)
-        {
-            const int productSymm = SymmInfo.directProd(irrep1,irrep2);
-            for (int irrep3 = irrep1; irrep3<numberOfIrreps; irrep3++)
-            {
-                const int irrep4 = SymmInfo.directProd(productSymm,irrep3);
-                // Generated all possible combinations of allowed irreps
-                if (irrep4>=irrep2)
-                {
-                    int linsize1 = index.getNORB(irrep1);
-                    int linsize2 =index.getNORB(irrep2);
-                    int linsize3 =index.getNORB(irrep3);
-                    int linsize4 =index.getNORB(irrep4);
+    //Two-body terms
+    transformVmat(*_hamorig, *_unitary, HamCI);
+}
 
-                    if ((linsize1>0) && (linsize2>0) && (linsize3>0) && (linsize4>0))
-                    {
-                        for (int cnt1=0; cnt1<linsize1; cnt1++)
-                            for (int cnt2=0; cnt2<linsize2; cnt2++)
-                                for (int cnt3=0; cnt3<linsize3; cnt3++)
-                                    for (int cnt4=0; cnt4<linsize4; cnt4++)
-                                        mem1[cnt1 + linsize1 * ( cnt2 + linsize2 * (cnt3 + linsize3 * cnt4) ) ]
-                                            = _hamorig->getVmat(index.getNstart(irrep1) + cnt1,index.getNstart(irrep2) + cnt2, index.getNstart(irrep3) + cnt3, index.getNstart(irrep4) + cnt4 );
-
-                        char trans = 'T';
-                        char notra = 'N';
-                        double alpha = 1.0;
-                        double beta  = 0.0; //SET !!!
-
-                        int rightdim = linsize2 * linsize3 * linsize4; //(ijkl) -> (ajkl)
-                        double * Umx = _unitary->getBlock(irrep1);
-                        dgemm_(&notra, &notra, &linsize1, &rightdim, &linsize1, &alpha, Umx, &linsize1, mem1.get(), &linsize1, &beta, mem2.get(), &linsize1);
-
-                        int leftdim = linsize1 * linsize2 * linsize3; //(ajkl) -> (ajkd)
-                        Umx = _unitary->getBlock(irrep4);
-                        dgemm_(&notra, &trans, &leftdim, &linsize4, &linsize4, &alpha, mem2.get(), &leftdim, Umx, &linsize4, &beta, mem1.get(), &leftdim);
-
-                        int jump1 = linsize1 * linsize2 * linsize3; //(ajkd) -> (ajcd)
-                        int jump2 = linsize1 * linsize2 * linsize3;
-                        leftdim   = linsize1 * linsize2;
-                        Umx = _unitary->getBlock(irrep3);
-                        for (int bla=0; bla<linsize4; bla++)
-                            dgemm_(&notra, &trans, &leftdim, &linsize3, &linsize3, &alpha, mem1.get()+jump1*bla, &leftdim, Umx, &linsize3, &beta, mem2.get()+jump2*bla, &leftdim);
-
-                        jump2    = linsize1 * linsize2;
-                        jump1    = linsize1 * linsize2;
-                        rightdim = linsize3 * linsize4;
-                        Umx = _unitary->getBlock(irrep2);
-                        for (int bla=0; bla<rightdim; bla++)
-                            dgemm_(&notra, &trans, &linsize1, &linsize2, &linsize2, &alpha, mem2.get()+jump2*bla, &linsize1, Umx, &linsize2, &beta, mem1.get()+jump1*bla, &linsize1);
-
-                        for (int cnt1=0; cnt1<linsize1; cnt1++)
-                            for (int cnt2=0; cnt2<linsize2; cnt2++)
-                                for (int cnt3=0; cnt3<linsize3; cnt3++)
-                                    for (int cnt4=0; cnt4<linsize4; cnt4++)
-                                        HamCI.setVmat(index.getNstart(irrep1) + cnt1,index.getNstart(irrep2) + cnt2, index.getNstart(irrep3) + cnt3,index.getNstart(irrep4) + cnt4, mem1[cnt1 + linsize1 * ( cnt2 + linsize2 * (cnt3 + linsize3 * cnt4) ) ] );
-
-                    } //end if the problem has orbitals from all 4 selected irreps
-                } // end if irrep 4 >= irrep2
-            }// end run irrep3
-        } // end run irrep2
+/**
+ * Transform the two-body terms of source with the unitary unit and store them in dest.
+ * Every irrep block is independent and writes its own part of Vmat, so source and dest
+ * can be the same Hamiltonian.
+ * @param source the hamiltonian to transform
+ * @param unit the unitary to use
+ * @param dest the hamiltonian to store the result in
+ * @param irreps only transform the blocks with at least one of these irreps (all irreps if empty)
+ */
+void OrbitalTransform::transformVmat(const Hamiltonian &source, const UnitaryMatrix &unit, Hamiltonian &dest, const std::vector<bool> &irreps)
+{
+    std::vector<int> todo;
+    todo.reserve(irrep_blocks.size());
+
+    for (unsigned int b=0; b<irrep_blocks.size(); b++)
+        if (irreps.empty() || irreps[irrep_blocks[b][0]] || irreps[irrep_blocks[b][1]] || irreps[irrep_blocks[b][2]] || irreps[irrep_blocks[b][3]])
+            todo.push_back(b);
+
+    const int nblocks = todo.size();
+
+    if (nblocks == 1)
+    {
+        //only one block (e.g. C1): parallelize the pair transformations inside the block
+        transformBlock(irrep_blocks[todo[0]], source, unit, mem1.get(), dest);
+        return;
+    }
+
+#ifdef _OPENMP
+    const int nthreads = max(1, min(omp_get_max_threads(), nblocks));
+#else
+    const int nthreads = 1;
+#endif
+
+    if(block_work.size() < (unsigned int) nthreads)
+        block_work.resize(nthreads);
+
+    //the blocks are sorted by cost: the largest go first, so dynamic scheduling balances the load
+#pragma omp parallel num_threads(nthreads)
+    {
+#ifdef _OPENMP
+        auto& work = block_work[omp_get_thread_num()];
+#else
+        auto& work = block_work[0];
+#endif
+        if(work.size() < max_block_size)
+            work.resize(max_block_size);
+
+#pragma omp for schedule(dynamic,1)
+        for (int b=0; b<nblocks; b++)
+            transformBlock(irrep_blocks[todo[b]], source, unit, work.data(), dest);
+    }
+}
+
+/**
+ * Rotate one pair index: (ik) -> (ac) = sum_ik Ua(a,i) Uc(c,k) (ik)
+ * @param vec the pair vector, element of pair P at vec[P*stride]
+ * @param stride the stride in vec
+ * @param packed true if both orbitals of the pair are in the same irrep (only i >= k is stored)
+ * @param size_i the number of orbitals in the irrep of the first orbital
+ * @param size_k the number of orbitals in the irrep of the second orbital
+ * @param Ui the unitary of the irrep of the first orbital
+ * @param Uk the unitary of the irrep of the second orbital
+ * @param work1 workspace of at least size_i*size_k doubles
+ * @param work2 workspace of at least size_i*size_k doubles
+ */
+static void rotate_pair(double *vec, const int stride, const bool packed, int size_i, int size_k, double *Ui, double *Uk, double *work1, double *work2)
+{
+    for (int k=0; k<size_k; k++)
+        for (int i=(packed ? k : 0); i<size_i; i++)
+            work1[i + size_i*k] = vec[stride * CheMPS2::FourIndex::getPairIndex(packed, size_i, i, k)];
+
+    if (packed)
+        for (int k=0; k<size_k; k++)
+            for (int i=0; i<k; i++)
+                work1[i + size_i*k] = work1[k + size_i*i];
+
+    char trans = 'T';
+    char notra = 'N';
+    double alpha = 1.0;
+    double beta  = 0.0; //SET !!!
+
+    dgemm_(&notra, &notra, &size_i, &size_k, &size_i, &alpha, Ui, &size_i, work1, &size_i, &beta, work2, &size_i);
+    dgemm_(&notra, &trans, &size_i, &size_k, &size_k, &alpha, work2, &size_i, Uk, &size_k, &beta, work1, &size_i);
+
+    for (int k=0; k<size_k; k++)
+        for (int i=(packed ? k : 0); i<size_i; i++)
+            vec[stride * CheMPS2::FourIndex::getPairIndex(packed, size_i, i, k)] = work1[i + size_i*k];
+}
+
+/**
+ * Transform one irrep block (irrep1 irrep2 | irrep3 irrep4) of the two-body integrals
+ * from source to dest. The block is kept packed in the pairs (13) and (24): V_ijkl = (ik|jl),
+ * so the pair (ik) with both orbitals in the same irrep is symmetric. Each pair index is
+ * rotated in turn with two matrix products.
+ * @param irreps the 4 irreps of the block
+ * @param source the hamiltonian to read the block from
+ * @param unit the unitary to use
+ * @param work workspace of at least n_13*n_24 doubles (the number of pairs (13) times (24))
+ * @param dest the hamiltonian to write the block to (can be source)
+ */
+void OrbitalTransform::transformBlock(const std::array<int,4> &irreps, const Hamiltonian &source, const UnitaryMatrix &unit, double *work, Hamiltonian& dest) const
+{
+    const int irrep1 = irreps[0];
+    const int irrep2 = irreps[1];
+    const int irrep3 = irreps[2];
+    const int irrep4 = irreps[3];
+
+    const int linsize1 = index.getNORB(irrep1);
+    const int linsize2 = index.getNORB(irrep2);
+    const int linsize3 = index.getNORB(irrep3);
+    const int linsize4 = index.getNORB(irrep4);
+
+    const bool packed13 = (irrep1 == irrep3);
+    const bool packed24 = (irrep2 == irrep4);
+    const int pairs13 = packed13 ? linsize1*(linsize1+1)/2 : linsize1*linsize3;
+    const int pairs24 = packed24 ? linsize2*(linsize2+1)/2 : linsize2*linsize4;
+
+    source.gatherVmatPairBlock(irrep1, irrep2, irrep3, irrep4, work);
+
+    // when called from the parallel loop over the blocks, these become serial loops (no nesting)
+#pragma omp parallel
+    {
+        std::vector<double> scratch(2 * max(linsize1*linsize3, linsize2*linsize4));
+
+        //(ik|jl) -> (ac|jl): the columns of the block
+#pragma omp for schedule(static)
+        for (int Q=0; Q<pairs24; Q++)
+            rotate_pair(work + pairs13*Q, 1, packed13, linsize1, linsize3, unit.getBlock(irrep1), unit.getBlock(irrep3), scratch.data(), scratch.data()+linsize1*linsize3);
+
+        //(ac|jl) -> (ac|bd): the rows of the block
+#pragma omp for schedule(static)
+        for (int P=0; P<pairs13; P++)
+            rotate_pair(work + P, pairs13, packed24, linsize2, linsize4, unit.getBlock(irrep2), unit.getBlock(irrep4), scratch.data(), scratch.data()+linsize2*linsize4);
+    }
+
+    dest.scatterVmatPairBlock(irrep1, irrep2, irrep3, irrep4, work);
 }
 
 /**
@@ -292,9 +512,6 @@ void OrbitalTransform::DoJacobiRotation(CheMPS2::Hamiltonian &ham_rot, int k, in
     const int irrep = ham_rot.getOrbitalIrrep(k);
     const int linsize = index.getNORB(irrep);
     const int shift = index.getNstart(irrep);
-    // the relative index in the irrep
-    const int k2 = k - shift;
-    const int l2 = l - shift;
 
     const double cos = std::cos(theta);
     const double sin = std::sin(theta);
@@ -332,97 +549,122 @@ void OrbitalTransform::DoJacobiRotation(CheMPS2::Hamiltonian &ham_rot, int k, in
     }
 
 
-    // the two particle elements
-    // this is code from Sebastian (CheMPS2) adapted to 
-    // Jacobi rotations in one irrep
-    // Two-body terms --> use eightfold permutation symmetry in the irreps :-)
-    for (int irrep1 = 0; irrep1<numberOfIrreps; irrep1++)
-        for (int irrep2 = irrep1; irrep2<numberOfIrreps; irrep2++)
+    // the two particle elements: only the elements with at least one index equal
+    // to k or l change. Thanks to the eightfold permutation symmetry, all of them can be
+    // written as V(x,b,c,d) with x = k or l. So we only need O(L^3) work instead of
+    // rotating every irrep block that touches the irrep of k and l.
+    const int L = ham_rot.getL();
+    const int kl[2] = {k, l};
+
+    // expand one index in the old basis
+    auto expand = [&](int x, int *idx, double *coef) -> int {
+        if(x == k)
         {
-            const int productSymm = SymmInfo.directProd(irrep1, irrep2);
-            for (int irrep3 = irrep1; irrep3<numberOfIrreps; irrep3++)
-            {
-                const int irrep4 = SymmInfo.directProd(productSymm, irrep3);
-                // Generated all possible combinations of allowed irreps
-                if(irrep4>=irrep2 && (irrep4==irrep || irrep3==irrep || irrep2==irrep || irrep1==irrep))
+            idx[0] = k; coef[0] = cos;
+            idx[1] = l; coef[1] = -sin;
+            return 2;
+        } else if (x == l)
+        {
+            idx[0] = l; coef[0] = cos;
+            idx[1] = k; coef[1] = sin;
+            return 2;
+        }
+
+        idx[0] = x; coef[0] = 1;
+        return 1;
+    };
+
+    auto allowed = [&](int a, int b, int c, int d) -> bool {
+        return SymmInfo.directProd(ham_rot.getOrbitalIrrep(a), ham_rot.getOrbitalIrrep(b)) == SymmInfo.directProd(ham_rot.getOrbitalIrrep(c), ham_rot.getOrbitalIrrep(d));
+    };
+
+    jacobi_work.resize(2ULL*L*L*L);
+
+    // first calculate all new elements, the old ones are still needed
+    for(int x=0;x<2;x++)
+        for(int b=0;b<L;b++)
+            for(int c=0;c<L;c++)
+                for(int d=0;d<L;d++)
                 {
-                    const int linsize1 = index.getNORB(irrep1);
-                    const int linsize2 = index.getNORB(irrep2);
-                    const int linsize3 = index.getNORB(irrep3);
-                    const int linsize4 = index.getNORB(irrep4);
+                    const int a = kl[x];
 
-                    if ((linsize1>0) && (linsize2>0) && (linsize3>0) && (linsize4>0))
-                    {
-                        for (int cnt1=0; cnt1<linsize1; cnt1++)
-                            for (int cnt2=0; cnt2<linsize2; cnt2++)
-                                for (int cnt3=0; cnt3<linsize3; cnt3++)
-                                    for (int cnt4=0; cnt4<linsize4; cnt4++)
-                                        mem1[cnt1 + linsize1 * ( cnt2 + linsize2 * (cnt3 + linsize3 * cnt4) ) ]
-                                            = ham_rot.getVmat(index.getNstart(irrep1) + cnt1,index.getNstart(irrep2) + cnt2, index.getNstart(irrep3) + cnt3, index.getNstart(irrep4) + cnt4 );
-
-                        int rightdim = linsize2 * linsize3 * linsize4;
-                        // (ijkl) -> (ajkl)
-                        if(irrep1 == irrep)
-                            for(int d=0;d<rightdim;d++)
-                            {
-                                const double tmpk = mem1[d*linsize1+k2];
-                                const double tmpl = mem1[d*linsize1+l2];
-
-                                mem1[d*linsize1+k2] = cos*tmpk-sin*tmpl;
-                                mem1[d*linsize1+l2] = cos*tmpl+sin*tmpk;
-                            }
-
-                        int leftdim = linsize1 * linsize2 * linsize3;
-                        // (ajkl) -> (ajkd)
-                        if(irrep4 == irrep)
-                            for(int d=0;d<leftdim;d++)
-                            {
-                                const double tmpk = mem1[k2*leftdim+d];
-                                const double tmpl = mem1[l2*leftdim+d];
-
-                                mem1[k2*leftdim+d] = cos*tmpk-sin*tmpl;
-                                mem1[l2*leftdim+d] = cos*tmpl+sin*tmpk;
-                            }
-
-                        int jump = linsize1 * linsize2 * linsize3;
-                        leftdim = linsize1 * linsize2;
-                        // (ajkd) -> (ajcd)
-                        if(irrep3 == irrep)
-                            for (int strideidx=0;strideidx<linsize4;strideidx++)
-                                for(int d=0;d<leftdim;d++)
-                                {
-                                    const double tmpk = mem1[k2*leftdim+d+jump*strideidx];
-                                    const double tmpl = mem1[l2*leftdim+d+jump*strideidx];
-
-                                    mem1[k2*leftdim+d+jump*strideidx] = cos*tmpk-sin*tmpl;
-                                    mem1[l2*leftdim+d+jump*strideidx] = cos*tmpl+sin*tmpk;
-                                }
-
-
-                        jump = linsize1 * linsize2;
-                        rightdim = linsize3 * linsize4;
-                        // (ajcd) -> (abcd)
-                        if(irrep2 == irrep)
-                            for (int strideidx=0;strideidx<rightdim;strideidx++)
-                                for(int d=0;d<linsize1;d++)
-                                {
-                                    const double tmpk = mem1[k2*linsize1+d+jump*strideidx];
-                                    const double tmpl = mem1[l2*linsize1+d+jump*strideidx];
-
-                                    mem1[k2*linsize1+d+jump*strideidx] = cos*tmpk-sin*tmpl;
-                                    mem1[l2*linsize1+d+jump*strideidx] = cos*tmpl+sin*tmpk;
-                                }
-
-                        for (int cnt1=0; cnt1<linsize1; cnt1++)
-                            for (int cnt2=0; cnt2<linsize2; cnt2++)
-                                for (int cnt3=0; cnt3<linsize3; cnt3++)
-                                    for (int cnt4=0; cnt4<linsize4; cnt4++)
-                                        ham_rot.setVmat(index.getNstart(irrep1) + cnt1,index.getNstart(irrep2) + cnt2, index.getNstart(irrep3) + cnt3,index.getNstart(irrep4) + cnt4, mem1[cnt1 + linsize1 * ( cnt2 + linsize2 * (cnt3 + linsize3 * cnt4) ) ] );
-
-                    } //end if the problem has orbitals from all 4 selected irreps
-                } // end if irrep 4 >= irrep2
-            }// end run irrep3
-        } // end run irrep2
+                    if(!allowed(a,b,c,d))
+                        continue;
+
+                    int ia[2], ib[2], ic[2], id[2];
+                    double ca[2], cb[2], cc[2], cd[2];
+
+                    const int na = expand(a, ia, ca);
+                    const int nb = expand(b, ib, cb);
+                    const int nc = expand(c, ic, cc);
+                    const int nd = expand(d, id, cd);
+
+                    double res = 0;
+
+                    for(int i1=0;i1<na;i1++)
+                        for(int i2=0;i2<nb;i2++)
+                            for(int i3=0;i3<nc;i3++)
+                                for(int i4=0;i4<nd;i4++)
+                                    res += ca[i1]*cb[i2]*cc[i3]*cd[i4] * ham_rot.getVmat(ia[i1],ib[i2],ic[i3],id[i4]);
+
+                    jacobi_work[d + L*(c + L*(b + 1ULL*L*x))] = res;
+                }
+
+    for(int x=0;x<2;x++)
+        for(int b=0;b<L;b++)
+            for(int c=0;c<L;c++)
+                for(int d=0;d<L;d++)
+                    if(allowed(kl[x],b,c,d))
+                        ham_rot.setVmat(kl[x], b, c, d, jacobi_work[d + L*(c + L*(b + 1ULL*L*x))]);
+}
+
+/**
+ * Update ham_rot in place with a sequence of jacobi rotations. The rotations are
+ * first accumulated in a small orthogonal matrix per irrep, which is then applied
+ * in one pass over Tmat and Vmat with matrix-matrix products. This gives the same
+ * result as calling DoJacobiRotation for each rotation in turn.
+ * @param ham_rot The Hamiltonian to update
+ * @param rotations the rotations (irrep, k, l, theta), in the order in which they should be applied
+ */
+void OrbitalTransform::DoJacobiRotations(CheMPS2::Hamiltonian &ham_rot, const std::vector<JacobiRotation> &rotations)
+{
+    if(rotations.empty())
+        return;
+
+    std::vector<bool> touched;
+    const auto G = _unitary->accumulate_rotations(rotations, touched);
+
+    // the one particle integrals: G * T * G^T
+    char trans = 'T';
+    char notra = 'N';
+    double alpha = 1.0;
+    double beta  = 0.0; //SET !!!
+
+    for (int irrep=0; irrep<numberOfIrreps; irrep++)
+    {
+        int linsize = index.getNORB(irrep);
+        const int shift = index.getNstart(irrep);
+
+        if(!touched[irrep] || linsize == 0)
+            continue;
+
+        double *Tblock = mem1.get();
+        double *work = mem1.get() + linsize*linsize;
+
+        for (int a=0; a<linsize; a++)
+            for (int b=0; b<linsize; b++)
+                Tblock[a + linsize*b] = ham_rot.getTmat(a+shift, b+shift);
+
+        dgemm_(&notra, &notra, &linsize, &linsize, &linsize, &alpha, G.getBlock(irrep), &linsize, Tblock, &linsize, &beta, work, &linsize);
+        dgemm_(&notra, &trans, &linsize, &linsize, &linsize, &alpha, work, &linsize, G.getBlock(irrep), &linsize, &beta, Tblock, &linsize);
+
+        for (int a=0; a<linsize; a++)
+            for (int b=a; b<linsize; b++)
+                ham_rot.setTmat(a+shift, b+shift, Tblock[a + linsize*b]);
+    }
+
+    // the two particle integrals: only the blocks with a rotated irrep change
+    transformVmat(ham_rot, G, ham_rot, touched);
 }
 
 /* vim: set ts=4 sw=4 expandtab :*/
@@ -0,0 +1,82 @@
+// CIFlow is a very flexible configuration interaction program
+// Copyright (C) 2014 Mario Van Raemdonck <mario.vanraemdonck@UGent.be>
+//
+// This file is part of CIFlow.
+//
+// CIFlow is private software; developed by Mario Van Raemdonck
+// a member of the Ghent Quantum Chemistry Group (Ghent University).
+// See also : http://www.quantum.ugent.be
+//
+// At this moment CIFlow is not yet distributed.
+// However this might change in the future in the hope that
+// it will be useful to someone.
+//
+// For now you have to ask the main author for permission.
+//
+//--
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <mpi.h>
+
+#include "OrbitalTransformMPI.h"
+
+namespace simanneal {
+
+/**
+ * Keep the two-body terms of the original hamiltonian in POSIX shared memory,
+ * so all the MPI ranks on one node use the same (read only) copy instead of
+ * one each. The first rank of every node creates and fills the mapping, the
+ * others map it and drop their own copy. When something fails, the ranks keep
+ * their own copy. This is collective on comm.
+ * @param orbtrans the OrbitalTransform of this rank
+ * @param comm the communicator of all the ranks that have the same original hamiltonian
+ */
+void share_original(OrbitalTransform &orbtrans, MPI_Comm comm)
+{
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+
+    int node_rank, node_size;
+    MPI_Comm_rank(node_comm, &node_rank);
+    MPI_Comm_size(node_comm, &node_size);
+
+    // decide together: a rank that returns early would leave the others waiting in the collectives below
+    int shared = orbtrans.original_is_shared();
+    MPI_Allreduce(MPI_IN_PLACE, &shared, 1, MPI_INT, MPI_LOR, node_comm);
+
+    if (node_size == 1 || shared)
+    {
+        MPI_Comm_free(&node_comm);
+        return;
+    }
+
+    // an unique name: the pid of the first rank of the node
+    long owner = getpid();
+    MPI_Bcast(&owner, 1, MPI_LONG, 0, node_comm);
+    const std::string name = "/v2dm-vmat-" + std::to_string(owner);
+
+    int created = 0;
+
+    if (node_rank == 0)
+        created = orbtrans.create_shared_original(name);
+
+    MPI_Bcast(&created, 1, MPI_INT, 0, node_comm);
+
+    if (created && node_rank != 0)
+        if (!orbtrans.attach_shared_original(name))
+            std::cerr << "Could not map the shared integrals, keeping a private copy" << std::endl;
+
+    // the name is not needed anymore once everybody has mapped it
+    MPI_Barrier(node_comm);
+
+    if (node_rank == 0 && created)
+        shm_unlink(name.c_str());
+
+    MPI_Comm_free(&node_comm);
+}
+
+}
+
+/* vim: set ts=4 sw=4 expandtab :*/
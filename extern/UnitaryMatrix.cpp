@@ -131,6 +131,52 @@ void UnitaryMatrix::jacobi_rotation(int irrep , int i , int j , double angle)
     }
 }
 
+UnitaryMatrix UnitaryMatrix::accumulate_rotations(const std::vector<JacobiRotation> &rotations, std::vector<bool> &touched) const
+{
+    // a new unitary starts as the identity
+    UnitaryMatrix G(*_index);
+
+    touched.assign(_index->getNirreps(), false);
+
+    for(auto &rot: rotations)
+    {
+        G.jacobi_rotation(std::get<0>(rot), std::get<1>(rot), std::get<2>(rot), std::get<3>(rot));
+        touched[std::get<0>(rot)] = true;
+    }
+
+    return G;
+}
+
+void UnitaryMatrix::multiply_left(const UnitaryMatrix &G, const std::vector<bool> &irreps)
+{
+    char notrans = 'N';
+    double alpha = 1.0;
+    double beta = 0.0; //SET !!!
+
+    for (int irrep=0; irrep<_index->getNirreps(); irrep++)
+    {
+        int linsize = _index->getNORB(irrep);
+
+        if( linsize == 0 || (!irreps.empty() && !irreps[irrep]) )
+            continue;
+
+        std::unique_ptr<double []> res(new double[linsize*linsize]);
+
+        dgemm_(&notrans,&notrans,&linsize,&linsize,&linsize,&alpha,G.unitary[irrep].get(),&linsize,unitary[irrep].get(),&linsize,&beta,res.get(),&linsize);
+
+        unitary[irrep] = std::move(res);
+    }
+}
+
+void UnitaryMatrix::jacobi_rotations(const std::vector<JacobiRotation> &rotations)
+{
+    std::vector<bool> touched;
+
+    const auto G = accumulate_rotations(rotations, touched);
+
+    multiply_left(G, touched);
+}
+
 void UnitaryMatrix::reset_unitary()
 {
    for (int irrep=0; irrep<_index->getNirreps(); irrep++)
@@ -543,6 +589,29 @@ void UnitaryMatrix::sendreceive(int orig)
     }
 }
 
+void UnitaryMatrix::exchange(int partner)
+{
+    const int num_irreps = _index->getNirreps();
+
+    std::vector< std::unique_ptr<double []> > received(num_irreps);
+    std::vector<MPI_Request> requests(2*num_irreps);
+
+    for (int irrep=0; irrep<num_irreps; irrep++)
+    {
+        const int linsize = _index->getNORB(irrep);
+        const int size = linsize * linsize;
+        received[irrep].reset(new double[size]);
+
+        MPI_Irecv(received[irrep].get(), size, MPI_DOUBLE, partner, irrep, MPI_COMM_WORLD, &requests[2*irrep]);
+        MPI_Isend(unitary[irrep].get(), size, MPI_DOUBLE, partner, irrep, MPI_COMM_WORLD, &requests[2*irrep+1]);
+    }
+
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+    for (int irrep=0; irrep<num_irreps; irrep++)
+        unitary[irrep] = std::move(received[irrep]);
+}
+
 
 int UnitaryMatrix::get_Nirrep() const
 {
@@ -20,6 +20,7 @@
 #ifndef FOURINDEX_CHEMPS2_H
 #define FOURINDEX_CHEMPS2_H
 
+#include <vector>
 #include "Irreps.h"
 
 namespace CheMPS2{
@@ -93,6 +94,69 @@ namespace CheMPS2{
 
          //! set everything to zero
          void reset();
+
+         //! The number of unique elements that are stored
+         /** \return The length of the storage array */
+         long long getArrayLength() const{ return arrayLength; }
+
+         //! The array with the elements
+         /** \return Pointer to the getArrayLength() elements */
+         double * getStorage(){ return theElements; }
+
+         //! Keep the elements in memory that is owned by somebody else (for example shared memory)
+         /** \param storage Array of length getArrayLength(), it should outlive this object
+             \param copy Whether the current elements should be copied to storage */
+         void useExternalStorage(double * storage, const bool copy);
+
+         //! Copy a whole symmetry block to a dense array
+         /** \param irrep_i The irrep number of the first orbital (see Irreps.h)
+             \param irrep_j The irrep number of the second orbital
+             \param irrep_k The irrep number of the third orbital
+             \param irrep_l The irrep number of the fourth orbital
+             \param dst Array of size n_i*n_j*n_k*n_l, element (i,j,k,l) is stored at i + n_i*(j + n_j*(k + n_k*l)) */
+         void gatherBlock(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, double * dst) const;
+
+         //! Set a whole symmetry block from a dense array
+         /** \param irrep_i The irrep number of the first orbital (see Irreps.h)
+             \param irrep_j The irrep number of the second orbital
+             \param irrep_k The irrep number of the third orbital
+             \param irrep_l The irrep number of the fourth orbital
+             \param src Array of size n_i*n_j*n_k*n_l, with the same layout as in gatherBlock */
+         void scatterBlock(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const double * src);
+
+         //! Copy a whole symmetry block to a dense array, packed in the pairs (i,k) and (j,l)
+         /** \param irrep_i The irrep number of the first orbital (see Irreps.h)
+             \param irrep_j The irrep number of the second orbital
+             \param irrep_k The irrep number of the third orbital
+             \param irrep_l The irrep number of the fourth orbital
+             \param dst Array of size n_P*n_Q, element (i,j,k,l) is stored at P + n_P*Q with P the pair index of (i,k) and Q the pair index of (j,l) (see getPairIndex) */
+         void gatherPairBlock(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, double * dst) const;
+
+         //! Set a whole symmetry block from a dense array, packed in the pairs (i,k) and (j,l)
+         /** \param irrep_i The irrep number of the first orbital (see Irreps.h)
+             \param irrep_j The irrep number of the second orbital
+             \param irrep_k The irrep number of the third orbital
+             \param irrep_l The irrep number of the fourth orbital
+             \param src Array of size n_P*n_Q, with the same layout as in gatherPairBlock */
+         void scatterPairBlock(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const double * src);
+
+         //! The number of pairs (i,k) with i in irrep_i and k in irrep_k: for irrep_i == irrep_k only i >= k is kept
+         /** \param irrep_i The irrep of the first orbital of the pair
+             \param irrep_k The irrep of the second orbital of the pair
+             \return The size of the pair space */
+         int getPairSize(const int irrep_i, const int irrep_k) const{
+            return (irrep_i == irrep_k) ? Isizes[irrep_i]*(Isizes[irrep_i]+1)/2 : Isizes[irrep_i]*Isizes[irrep_k];
+         }
+
+         //! The index of the pair (i,k) in the pair space of (irrep_i,irrep_k)
+         /** \param same_irrep Whether irrep_i == irrep_k
+             \param size_i The number of orbitals in irrep_i
+             \param i The first index of the pair (within the irrep)
+             \param k The second index of the pair (within the irrep), for same_irrep, k <= i is needed
+             \return The pair index: k + i*(i+1)/2 for same_irrep, i + size_i*k otherwise */
+         static int getPairIndex(const bool same_irrep, const int size_i, const int i, const int k){
+            return same_irrep ? k + i*(i+1)/2 : i + size_i*k;
+         }
       
       private:
       
@@ -100,7 +164,10 @@ namespace CheMPS2{
          Irreps SymmInfo;
          
          //Array with length the number of irreps of the specified group, containing the number of orbitals of that irrep
-         int * Isizes;
+         std::vector<int> Isizes;
+
+         //The number of irreps
+         int numIrreps;
          
          /*The following conventions are used for storage:
             - 8-fold permutation symmetry: V_ijkl = V_jilk = V_ilkj = V_lijk = V_kjil = V_jkli = V_klij = V_lkji
@@ -123,20 +190,38 @@ namespace CheMPS2{
                         - If I_i == I_k and hence I_j == I_l : index k>=i and index l>=j
                         - Vmat[Icent][I_i][I_i][i + k*(k+1)/2][j][l-j]
                         - If I_i <  I_k and hence I_j <  I_l : fixed by block order
-                        - Vmat[Icent][I_i][I_k][i + nOrbWithIrrepI_i * k][j][l] */
-         long long ***** storage;
-         
-         //Calculate the number of unique FourIndex elements --> true means allocate the storage and false means deallocate the storage!
-         long long calcNumberOfUniqueElements(const bool allocateStorage);
+                        - Vmat[Icent][I_i][I_k][i + nOrbWithIrrepI_i * k][j][l]
+            - The offsets Vmat[Icent][I_i][I_k][row][j] are kept in flat tables: storage() below */
+
+         //For each block (Icent,I_i,I_k): the start of its rows in rowStart, -1 if the block doesn't exist
+         std::vector<long long> blockStart;
+
+         //For each row of a block: the start of its entries in offsets
+         std::vector<long long> rowStart;
+
+         //The offset in theElements of the first element of each (row,j)
+         std::vector<long long> offsets;
+
+         inline long long storage(const int Icent, const int irrep_i, const int irrep_k, const int row, const int j) const{
+            return offsets[rowStart[blockStart[(Icent*numIrreps + irrep_i)*numIrreps + irrep_k] + row] + j];
+         }
+
+         //Calculate the number of unique FourIndex elements and build the offset tables
+         long long calcNumberOfUniqueElements();
          
          //The number of unique FourIndex elements
          long long arrayLength;
          
          //The actual two-body matrix elements
          double * theElements;
+
+         //Whether theElements should be deleted by this object
+         bool ownsElements;
          
          //Functions to get the correct pointer to memory
          long long getPointer(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const int i, const int j, const int k, const int l) const;
+         int getIrrepOrdering(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l) const;
+         long long getPtrOrdering(const int ordering, const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const int i, const int j, const int k, const int l) const;
          long long getPtrIrrepOrderOK(const int irrep_i, const int irrep_j, const int irrep_k, const int irrep_l, const int i, const int j, const int k, const int l) const;
          long long getPtrAllOK(const int number, const int Icent, const int irrep_i, const int irrep_k, const int i, const int j, const int k, const int l) const;
 
@@ -143,6 +143,51 @@ namespace CheMPS2{
              \param index4 The fourth index
              \return \f$V_{index1,index2,index3,index4}\f$ */
          double getVmat(const int index1, const int index2, const int index3, const int index4) const;
+
+         //! Get a whole symmetry block of Vmat
+         /** \param irrep1 The irrep of the first index
+             \param irrep2 The irrep of the second index
+             \param irrep3 The irrep of the third index
+             \param irrep4 The irrep of the fourth index
+             \param dst Array of size n1*n2*n3*n4, element (i,j,k,l) of the block is stored at i + n1*(j + n2*(k + n3*l)) */
+         void gatherVmatBlock(const int irrep1, const int irrep2, const int irrep3, const int irrep4, double * dst) const;
+
+         //! Set a whole symmetry block of Vmat
+         /** \param irrep1 The irrep of the first index
+             \param irrep2 The irrep of the second index
+             \param irrep3 The irrep of the third index
+             \param irrep4 The irrep of the fourth index
+             \param src Array of size n1*n2*n3*n4, with the same layout as in gatherVmatBlock */
+         void scatterVmatBlock(const int irrep1, const int irrep2, const int irrep3, const int irrep4, const double * src);
+
+         //! Get a whole symmetry block of Vmat, packed in the pairs (index1,index3) and (index2,index4) (see FourIndex::gatherPairBlock)
+         /** \param irrep1 The irrep of the first index
+             \param irrep2 The irrep of the second index
+             \param irrep3 The irrep of the third index
+             \param irrep4 The irrep of the fourth index
+             \param dst Array of size n_13*n_24, with n_13 the number of pairs (index1,index3) */
+         void gatherVmatPairBlock(const int irrep1, const int irrep2, const int irrep3, const int irrep4, double * dst) const;
+
+         //! Set a whole symmetry block of Vmat, packed in the pairs (index1,index3) and (index2,index4) (see FourIndex::scatterPairBlock)
+         /** \param irrep1 The irrep of the first index
+             \param irrep2 The irrep of the second index
+             \param irrep3 The irrep of the third index
+             \param irrep4 The irrep of the fourth index
+             \param src Array of size n_13*n_24, with the same layout as in gatherVmatPairBlock */
+         void scatterVmatPairBlock(const int irrep1, const int irrep2, const int irrep3, const int irrep4, const double * src);
+
+         //! The number of unique Vmat elements that are stored (see FourIndex::getArrayLength)
+         /** \return The length of the Vmat storage */
+         long long getVmatLength() const;
+
+         //! The array with the Vmat elements (see FourIndex::getStorage)
+         /** \return Pointer to the getVmatLength() elements */
+         double * getVmatStorage();
+
+         //! Keep the Vmat elements in external memory (see FourIndex::useExternalStorage)
+         /** \param storage Array of length getVmatLength(), it should outlive this object
+             \param copy Whether the current elements should be copied to storage */
+         void useExternalVmat(double * storage, const bool copy);
          
          //! Save the Hamiltonian
          /** \param file_parent The HDF5 Hamiltonian parent filename
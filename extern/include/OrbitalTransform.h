@@ -3,27 +3,29 @@
 
 #include <assert.h>
 #include <memory>
+#include <array>
 #include <vector>
+#include <string>
 #include "Irreps.h"
 #include "OptIndex.h"
+#include "UnitaryMatrix.h"
 
 namespace CheMPS2 { class Hamiltonian; }
 
 namespace simanneal {
 
-class UnitaryMatrix;
-
 class OrbitalTransform
 {
     public :
         OrbitalTransform(const CheMPS2::Hamiltonian& ham);
-        virtual ~OrbitalTransform() = default;
+        virtual ~OrbitalTransform();
 
         void fillHamCI(CheMPS2::Hamiltonian& HamCI);	
         void fillConstAndTmat(CheMPS2::Hamiltonian& Ham) const;
         void buildOneBodyMatrixElements();
         void set_unitary(UnitaryMatrix& unit);
-        CheMPS2::Hamiltonian& get_ham() { return (*_hamorig); }
+        //! the two-body terms are read only (PROT_READ) once they are in shared memory
+        CheMPS2::Hamiltonian& get_ham() { assert(!original_is_shared()); return (*_hamorig); }
         const CheMPS2::Hamiltonian& get_ham() const { return (*_hamorig); }
 
         double TmatRotated(const int index1, const int index2) const;
@@ -37,11 +39,25 @@ class OrbitalTransform
 
         void DoJacobiRotation(CheMPS2::Hamiltonian &, int k, int l, double theta);
 
+        void DoJacobiRotations(CheMPS2::Hamiltonian &, const std::vector<JacobiRotation> &rotations);
+
         void update_unitary(const UnitaryMatrix &, bool replace=false);
 
+        void share_original(OrbitalTransform &owner);
+
+        bool create_shared_original(const std::string &name);
+
+        bool attach_shared_original(const std::string &name);
+
+        bool original_is_shared() const { return shared_vmat != nullptr; }
+
     private:
         void rotate_old_to_new(std::unique_ptr<double []> * matrix);
 
+        void transformVmat(const CheMPS2::Hamiltonian &source, const UnitaryMatrix &unit, CheMPS2::Hamiltonian &dest, const std::vector<bool> &irreps = std::vector<bool>());
+
+        void transformBlock(const std::array<int,4> &irreps, const CheMPS2::Hamiltonian &source, const UnitaryMatrix &unit, double *work, CheMPS2::Hamiltonian& dest) const;
+
         //! the orginal hamiltonian
         std::unique_ptr<CheMPS2::Hamiltonian> _hamorig;
         //! The rotation to perfrom on _hamorig to get the current hamiltonian
@@ -61,6 +77,21 @@ class OrbitalTransform
         std::unique_ptr<double []> mem1;
         std::unique_ptr<double []> mem2;
 
+        //! all irrep blocks (irrep1 irrep2 | irrep3 irrep4) of the two-body terms, most expensive first
+        std::vector< std::array<int,4> > irrep_blocks;
+        //! the size of the largest (packed) irrep block
+        unsigned long long max_block_size;
+        //! per thread workspace for fillHamCI
+        std::vector< std::vector<double> > block_work;
+
+        //! scratch space for DoJacobiRotation: the new elements V(x,b,c,d) with x = k or l
+        std::vector<double> jacobi_work;
+
+        //! the shared memory mapping with the two-body terms of _hamorig (see create_shared_original)
+        void * shared_vmat;
+        //! the length of the mapping in bytes
+        size_t shared_length;
+
 };
 
 }
@@ -0,0 +1,15 @@
+#ifndef __OrbitalTransformMPI__
+#define __OrbitalTransformMPI__
+
+#include <mpi.h>
+#include "OrbitalTransform.h"
+
+namespace simanneal {
+
+    void share_original(OrbitalTransform &orbtrans, MPI_Comm comm);
+
+}
+
+#endif
+
+/* vim: set ts=4 sw=4 expandtab :*/
@@ -19,10 +19,14 @@
 
 #include <memory>
 #include <vector>
+#include <tuple>
 #include "OptIndex.h" //For optindex (should put this in a separate file)
 
 namespace simanneal {
 
+//! A jacobi rotation (irrep, i, j, angle): the arguments of UnitaryMatrix::jacobi_rotation
+typedef std::tuple<int,int,int,double> JacobiRotation;
+
 /** unitary class.
     The UnitaryMatrix class is a storage and manipulation class for the unitary matrix. This matrix is blockdiagonal in the irreducible representations, and is formed by stepwise multiplying in new unitary rotations due to the Newton-Raphson algorithm.
 */
@@ -96,6 +100,23 @@ class UnitaryMatrix
         //! Implements a simple jacobi rotation of the i, and j th orbital.
         void jacobi_rotation(int irrep, int i, int j, double angle);
 
+        //! Apply a sequence of jacobi rotations at once
+        /** The rotations are first accumulated in a small orthogonal matrix per irrep, which
+            is then multiplied in with one dgemm per irrep that was touched
+            \param rotations The rotations, in the order in which they would be applied with jacobi_rotation */
+        void jacobi_rotations(const std::vector<JacobiRotation> &rotations);
+
+        //! Multiply a unitary in from the left: U <- G * U
+        /** \param G The unitary to multiply with
+            \param irreps Only do the irreps for which this is true, all irreps if empty */
+        void multiply_left(const UnitaryMatrix &G, const std::vector<bool> &irreps = std::vector<bool>());
+
+        //! Accumulate a sequence of jacobi rotations in an identity matrix
+        /** \param rotations The rotations, in the order in which they would be applied with jacobi_rotation
+            \param touched On exit, true for every irrep in which a rotation was done
+            \return The product of all rotations */
+        UnitaryMatrix accumulate_rotations(const std::vector<JacobiRotation> &rotations, std::vector<bool> &touched) const;
+
         //! Resets the unitary matrix
         void reset_unitary();
 
@@ -105,6 +126,10 @@ class UnitaryMatrix
 
         void sendreceive(int);
 
+        //! Swap the unitary with the one of another MPI rank (nonblocking send and receive)
+        /** \param partner The rank to swap with, it should call this with our rank at the same time */
+        void exchange(int partner);
+
         int get_Nirrep() const;
 
         void updateUnitary(double *, double *, const UnitaryMatrix &, bool);
@@ -145,6 +145,8 @@ class BlockStructure
 
       virtual void sep_pm(BlockStructure<BlockType> &, BlockStructure<BlockType> &);
 
+      void segments(Segments &) const;
+
    private:
 
       std::vector< std::unique_ptr<BlockType> > blocks;
@@ -71,6 +71,10 @@ class BoundaryPoint: public Method
 
       void set_max_iter(unsigned int);
 
+      void set_max_primal_iter(unsigned int);
+
+      void set_max_rotate_angle(double);
+
       double get_tol_PD() const;
 
       SUP& getX() const;
@@ -85,6 +89,8 @@ class BoundaryPoint: public Method
 
       void set_use_prev_result(bool);
 
+      void rotate(int, int, double);
+
       double evalEnergy() const;
 
       void ReturnHighWhenBailingOut(bool);
@@ -111,6 +117,9 @@ class BoundaryPoint: public Method
 
       std::unique_ptr<Lineq> lineq;
 
+      //! scratch space for Run()
+      std::unique_ptr<Workspace> ws;
+
       double nuclrep;
 
       double tol_PD, tol_en;
@@ -121,6 +130,12 @@ class BoundaryPoint: public Method
 
       unsigned int max_iter;
 
+      //! maximum number of primal iterations in Run(), 0 for no limit
+      unsigned int max_primal_iter;
+
+      //! rotate() keeps the unrotated start point for larger angles
+      double max_rotate_angle;
+
       unsigned int avg_iters;
 
       unsigned int iters;
@@ -145,6 +145,8 @@ class Container
 
       void sep_pm(Container &,Container &);
 
+      void segments(Segments &) const;
+
    private:
 
       std::unique_ptr<BlockMatrix> matrix;
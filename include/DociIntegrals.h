@@ -0,0 +1,113 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+
+#ifndef DOCI_INTEGRALS_H
+#define DOCI_INTEGRALS_H
+
+#include <vector>
+#include <cassert>
+
+namespace CheMPS2 { class Hamiltonian; }
+
+namespace doci2DM
+{
+
+/**
+ * The part of the integrals that DOCI actually uses, in a few dense LxL arrays:
+ * the one-particle matrix T(a,b) and the two-particle elements V(a,a,b,b),
+ * V(a,b,a,b) and V(a,b,b,a). For a jacobi rotation between k and l we also
+ * need the k/l slices, these are read from the source Hamiltonian when asked for,
+ * so that Hamiltonian should outlive the digest. Build it once and use it for
+ * TPM::ham and the orbital scans.
+ */
+class DociIntegrals
+{
+   public:
+
+      DociIntegrals(int L);
+
+      DociIntegrals(const CheMPS2::Hamiltonian &);
+
+      // a copy would share the non-owned source Hamiltonian
+      DociIntegrals(const DociIntegrals &) = delete;
+
+      DociIntegrals(DociIntegrals &&) = default;
+
+      virtual ~DociIntegrals() = default;
+
+      DociIntegrals& operator=(const DociIntegrals &) = delete;
+
+      DociIntegrals& operator=(DociIntegrals &&) = default;
+
+      int gL() const;
+
+      inline double T(int a, int b) const { return oei[a*L+b]; }
+
+      inline double &T(int a, int b) { return oei[a*L+b]; }
+
+      //! V(a,a,b,b)
+      inline double Vaabb(int a, int b) const { return aabb[a*L+b]; }
+
+      inline double &Vaabb(int a, int b) { return aabb[a*L+b]; }
+
+      //! V(a,b,a,b)
+      inline double Vabab(int a, int b) const { return abab[a*L+b]; }
+
+      inline double &Vabab(int a, int b) { return abab[a*L+b]; }
+
+      //! V(a,b,b,a)
+      inline double Vabba(int a, int b) const { return abba[a*L+b]; }
+
+      inline double &Vabba(int a, int b) { return abba[a*L+b]; }
+
+      bool has_slices() const;
+
+      void get_slice(int k, int l, double *slice) const;
+
+   private:
+
+      //! nr of spatial orbitals
+      int L;
+
+      //! T(a,b)
+      std::vector<double> oei;
+
+      //! V(a,a,b,b)
+      std::vector<double> aabb;
+
+      //! V(a,b,a,b)
+      std::vector<double> abab;
+
+      //! V(a,b,b,a)
+      std::vector<double> abba;
+
+      //! the hamiltonian for the k/l slices, can be null. Not owned: should outlive us.
+      const CheMPS2::Hamiltonian *source;
+};
+
+}
+
+#endif /* DOCI_INTEGRALS_H */
+
+/* vim: set ts=3 sw=3 expandtab :*/
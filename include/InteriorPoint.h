@@ -0,0 +1,151 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#ifndef INTERIOR_POINT_H
+#define INTERIOR_POINT_H
+
+#include <vector>
+
+#include "include.h"
+
+//! the maximal size of the Schur complement in InteriorPoint (in MB)
+#define IP_MAX_SCHUR_MB 1024
+
+namespace CheMPS2 { class Hamiltonian; }
+
+namespace doci2DM
+{
+
+/**
+ * A primal-dual interior point method with Mehrotra's predictor-corrector
+ * steps and the Nesterov-Todd scaling. The primal variable is the rdm, its
+ * SUP image X = (rdm, Q(rdm), G(rdm)) and the dual SUP Z are kept positive
+ * definite. The Schur complement of the Newton system is the hessian of
+ * TPM::H with the scaling W^{-1} instead of the inverse of X. It is assembled
+ * in an orthonormal basis of the TPM space (the LxL block and the vector with
+ * degeneracy 4, so L^2 columns), factorized once with a Cholesky decomposition
+ * and used for both the predictor and the corrector step. The linear equality
+ * constraints only live in the orbital part of the TPM (see Lineq) and are
+ * added to the Schur complement as a projection, so no extra multipliers are
+ * needed.
+ * The block structure is only used through the maps (fill, collaps, H): the
+ * Schur complement itself is a dense L^2 x L^2 matrix. It needs L^4 doubles
+ * (80 MB at L=56, 800 MB at L=100) and the Cholesky decomposition is O(L^6),
+ * so this is meant for small and medium L. Run() throws a std::runtime_error
+ * when the Schur complement would be larger than IP_MAX_SCHUR_MB.
+ */
+class InteriorPoint: public Method
+{
+   public:
+
+      InteriorPoint(const CheMPS2::Hamiltonian &);
+
+      InteriorPoint(const TPM &);
+
+      InteriorPoint(const InteriorPoint &);
+
+      InteriorPoint(InteriorPoint &&) = default;
+
+      virtual ~InteriorPoint() = default;
+
+      InteriorPoint& operator=(const InteriorPoint &);
+
+      InteriorPoint& operator=(InteriorPoint &&) = default;
+
+      InteriorPoint* Clone() const;
+
+      InteriorPoint* Move();
+
+      void BuildHam(const CheMPS2::Hamiltonian &);
+
+      void BuildHam(const TPM &);
+
+      unsigned int Run();
+
+      double getFullEnergy() const;
+
+      void set_tolerance(double);
+
+      void set_max_iter(unsigned int);
+
+      double get_gap() const;
+
+      double get_D_conv() const;
+
+      TPM& getRDM() const;
+
+      TPM& getHam() const;
+
+      SUP& getZ() const;
+
+      Lineq& getLineq() const;
+
+      double evalEnergy() const;
+
+      bool FullyConverged() const;
+
+   private:
+
+      void pack(const TPM &, double *) const;
+
+      void unpack(const double *, TPM &) const;
+
+      int factorize_schur(const SUP &);
+
+      void solve_schur(const SUP &, const SUP &, const TPM &, TPM &, SUP &, SUP &) const;
+
+      static double max_step(const SUP &, const SUP &);
+
+      std::unique_ptr<TPM> ham;
+
+      std::unique_ptr<TPM> rdm;
+
+      //! the dual variable
+      std::unique_ptr<SUP> Z;
+
+      std::unique_ptr<Lineq> lineq;
+
+      //! the Cholesky factor of the Schur complement (column major, lower triangle)
+      std::vector<double> schur;
+
+      double nuclrep;
+
+      double norm_ham;
+
+      //! stop when the relative duality gap and the dual infeasibility are below this
+      double tolerance;
+
+      unsigned int max_iter;
+
+      //! the relative duality gap of the last iteration
+      double gap;
+
+      //! the dual infeasibility of the last iteration
+      double D_conv;
+};
+
+}
+
+#endif /* INTERIOR_POINT_H */
+
+/* vim: set ts=3 sw=3 expandtab :*/
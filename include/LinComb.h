@@ -0,0 +1,238 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#ifndef LINCOMB_H
+#define LINCOMB_H
+
+#include <array>
+#include <type_traits>
+#include <assert.h>
+
+//! the maximum number of contiguous memory segments in one object
+#define LINCOMB_MAX_SEG 16
+
+//! the maximum number of terms in one linear combination
+#define LINCOMB_MAX_TERMS 8
+
+namespace doci2DM
+{
+
+/**
+ * The contiguous memory segments that make up an object. Objects
+ * of the same shape give the same list of segments, so a linear
+ * combination of them can be done segment by segment.
+ */
+class Segments
+{
+   public:
+
+      Segments() { nseg = 0; }
+
+      void add(double *p, int n)
+      {
+         assert(nseg < LINCOMB_MAX_SEG);
+
+         ptr[nseg] = p;
+         size[nseg] = n;
+         ++nseg;
+      }
+
+      //! the number of segments
+      int nseg;
+
+      //! start of each segment
+      double *ptr[LINCOMB_MAX_SEG];
+
+      //! length of each segment
+      int size[LINCOMB_MAX_SEG];
+};
+
+void lincomb(Segments &, int, const double *, const Segments *, bool);
+
+/**
+ * Classes that can be used in a LinComb should specialize this
+ * to std::true_type. They need a segments(Segments &) const member.
+ */
+template<class T>
+struct is_lincomb_type : std::false_type {};
+
+/**
+ * Expression template for the linear combination
+ * alpha[0]*terms[0] + ... + alpha[n-1]*terms[n-1]. Nothing is
+ * calculated until the expression is assigned to an object, which
+ * is then done in one fused pass over memory.
+ */
+template<class T, int n>
+class LinComb
+{
+   public:
+
+      //! the coefficients
+      std::array<double,n> alpha;
+
+      //! the objects (only references, they should outlive the expression)
+      std::array<const T*,n> terms;
+
+      /**
+       * Evaluate the expression
+       * @param out the object to store the result in
+       * @param add if true, add the result to out instead of overwriting it
+       */
+      void eval(T &out, bool add) const
+      {
+         static_assert(n <= LINCOMB_MAX_TERMS, "Too many terms in linear combination");
+
+         Segments seg_out;
+         out.segments(seg_out);
+
+         Segments seg_in[n];
+
+         for(int i=0;i<n;i++)
+            terms[i]->segments(seg_in[i]);
+
+         lincomb(seg_out, n, alpha.data(), seg_in, add);
+      }
+};
+
+template<class T>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,1>>::type operator*(double alpha, const T &x)
+{
+   LinComb<T,1> res;
+   res.alpha[0] = alpha;
+   res.terms[0] = &x;
+
+   return res;
+}
+
+template<class T>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,1>>::type operator*(const T &x, double alpha)
+{
+   return alpha * x;
+}
+
+template<class T>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,1>>::type operator/(const T &x, double alpha)
+{
+   return (1.0/alpha) * x;
+}
+
+template<class T, int n>
+LinComb<T,n> operator*(double alpha, LinComb<T,n> x)
+{
+   for(auto &a: x.alpha)
+      a *= alpha;
+
+   return x;
+}
+
+template<class T, int n>
+LinComb<T,n> operator*(const LinComb<T,n> &x, double alpha)
+{
+   return alpha * x;
+}
+
+template<class T, int n>
+LinComb<T,n> operator/(const LinComb<T,n> &x, double alpha)
+{
+   return (1.0/alpha) * x;
+}
+
+template<class T, int n>
+LinComb<T,n> operator-(const LinComb<T,n> &x)
+{
+   return -1.0 * x;
+}
+
+template<class T>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,1>>::type operator-(const T &x)
+{
+   return -1.0 * x;
+}
+
+template<class T, int n, int m>
+LinComb<T,n+m> operator+(const LinComb<T,n> &x, const LinComb<T,m> &y)
+{
+   LinComb<T,n+m> res;
+
+   for(int i=0;i<n;i++)
+   {
+      res.alpha[i] = x.alpha[i];
+      res.terms[i] = x.terms[i];
+   }
+
+   for(int i=0;i<m;i++)
+   {
+      res.alpha[n+i] = y.alpha[i];
+      res.terms[n+i] = y.terms[i];
+   }
+
+   return res;
+}
+
+template<class T, int n, int m>
+LinComb<T,n+m> operator-(const LinComb<T,n> &x, const LinComb<T,m> &y)
+{
+   return x + (-1.0) * y;
+}
+
+template<class T, int n>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,n+1>>::type operator+(const LinComb<T,n> &x, const T &y)
+{
+   return x + 1.0 * y;
+}
+
+template<class T, int n>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,n+1>>::type operator-(const LinComb<T,n> &x, const T &y)
+{
+   return x + (-1.0) * y;
+}
+
+template<class T, int n>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,n+1>>::type operator+(const T &x, const LinComb<T,n> &y)
+{
+   return 1.0 * x + y;
+}
+
+template<class T, int n>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,n+1>>::type operator-(const T &x, const LinComb<T,n> &y)
+{
+   return 1.0 * x - y;
+}
+
+template<class T>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,2>>::type operator+(const T &x, const T &y)
+{
+   return 1.0 * x + 1.0 * y;
+}
+
+template<class T>
+typename std::enable_if<is_lincomb_type<T>::value, LinComb<T,2>>::type operator-(const T &x, const T &y)
+{
+   return 1.0 * x + (-1.0) * y;
+}
+
+}
+
+#endif /* LINCOMB_H */
+
+/* vim: set ts=3 sw=3 expandtab :*/
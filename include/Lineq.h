@@ -61,43 +61,51 @@ class Lineq
 
       int gL() const;
 
-      const TPM &gE(int) const;
+      TPM gE(int) const;
 
       double ge(int) const;
 
-      const TPM &gE_ortho(int) const;
+      TPM gE_ortho(int) const;
 
       double ge_ortho(int) const;
 
-      const SUP &gu_0(int) const;
+      const double *gE_orb(int) const;
 
-      const SUP &gu_0_ortho(int) const;
+      const double *gE_ortho_orb(int) const;
+
+      double orb_ddot(const double *, const double *) const;
+
+      SUP gu_0(int) const;
 
       void check(const TPM &tpm) const;
 
       void orthogonalize();
 
-   private:
+      bool has_inverse_S() const;
 
-      void constr_u_0();
+      const double *gS_inv() const;
+
+      double gS_kappa() const;
+
+   private:
 
-      void orthogonalize_u_0();
+      void constr_inverse_S();
 
-      //!double pointer to TPM object, will contain the linear equality constraints
-      std::vector<TPM> E;
+      //!the linear equality constraints in orbital coordinates (see TPM::get_orbital_part), 2L doubles per constraint
+      std::vector<double> E;
       //!pointer of doubles, will contain the values of the projections. (the desired equalities)
       std::vector<double> e;
       
-      //!orthogonalized constraints, these will be hidden from the public.
-      std::vector<TPM> E_ortho;
+      //!orthogonalized constraints in orbital coordinates, these will be hidden from the public.
+      std::vector<double> E_ortho;
       //!the values accompanying the orthogonalized constraints
       std::vector<double> e_ortho;
 
-      //!will contain the matrices that span u^0 space
-      std::vector<SUP> u_0;
+      //!the inverse of the overlap map on the orbital part of the TPM (column major, 2L x 2L), empty if not available
+      std::vector<double> S_inv;
 
-      //!will contain the orthogonalized matrices that span u^0 space
-      std::vector<SUP> u_0_ortho;
+      //!the overlap map is S_kappa times the identity outside the orbital part
+      double S_kappa;
 
       //!nr of particles
       int N;
@@ -72,6 +72,8 @@ class LocalMinimizer
 
       void UsePotentialReduction();
 
+      void UseInteriorPoint();
+
       doci2DM::PotentialReduction& getMethod_PR() const;
 
       doci2DM::BoundaryPoint& getMethod_BP() const;
@@ -84,14 +86,34 @@ class LocalMinimizer
 
       void set_conv_steps(int);
 
+      void set_scan_screening(double);
+
       int choose_orbitalpair(std::vector<std::tuple<int,int,double,double>> &);
 
       int Minimize_noOpt(double stopcrit);
 
       int Minimize_hybrid();
 
+      int Minimize_sweep(int start_iters=0);
+
+      int Minimize_speculative(int nr_candidates, int start_iters=0);
+
+      int Minimize_coupled(int start_iters=0);
+
+      void set_coupled_iters(unsigned int);
+
+      void set_max_steps(int);
+
+      void set_output(bool);
+
+      void set_save_steps(bool);
+
+      bool Converged() const;
+
    private:
 
+      std::vector< std::pair<int,int> > orbital_pairs() const;
+
       //! criteria for convergence of the minimizer
       double conv_crit;
 
@@ -100,6 +122,24 @@ class LocalMinimizer
       //! number of steps in convergence area
       int conv_steps;
 
+      //! skip orbital pairs with |V(k,l,l,k)| below this in scan_orbitals
+      double scan_screening;
+
+      //! number of primal iterations after every orbital step in Minimize_coupled()
+      unsigned int coupled_iters;
+
+      //! maximal number of orbital steps in the Minimize_* modes
+      int max_steps;
+
+      //! print the progress
+      bool do_output;
+
+      //! write every step of the Minimize_* modes to disk
+      bool save_steps;
+
+      //! whether the last Minimize_* call reached conv_steps steps within conv_crit
+      bool did_converge;
+
       std::unique_ptr<doci2DM::Method> method;
 
       //! Holds the current hamiltonian
@@ -39,6 +39,7 @@ namespace doci2DM
  */
 
 class Vector;
+class Segments;
 
 class Matrix
 {
@@ -104,14 +105,10 @@ class Matrix
 
       Vector diagonalize();
 
-      Vector diagonalize_2x2();
-
       double ddot(const Matrix &) const;
 
       void invert();
 
-      void invert_2x2();
-
       void dscal(double alpha);
 
       void fill_Random();
@@ -121,24 +118,20 @@ class Matrix
       //positieve of negatieve vierkantswortel uit de matrix
       void sqrt(int option);
 
-      void sqrt_2x2(int option);
-
       void mdiag(const Vector &);
 
       void L_map(const Matrix &,const Matrix &);
 
-      void L_map_2x2(const Matrix &,const Matrix &);
-
       void symmetrize();
 
       void SaveRawToFile(const std::string) const;
 
       void sep_pm(Matrix &,Matrix &);
 
-      void sep_pm_2x2(Matrix &,Matrix &);
-
       void unit();
 
+      void segments(Segments &) const;
+
    private:
 
       //!pointer of doubles, contains the numbers, the matrix
@@ -62,6 +62,8 @@ class Method
 
       virtual void set_outfile(std::string filename) { outfile = filename; }
 
+      const std::string& get_outfile() const { return outfile; }
+
       virtual bool FullyConverged() const = 0;
 
    protected:
@@ -0,0 +1,86 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#ifndef MULTISTART_H
+#define MULTISTART_H
+
+#include <memory>
+#include <vector>
+
+#include "Hamiltonian.h"
+#include "LocalMinimizer.h"
+
+namespace simanneal {
+
+/**
+ * Runs the local minimizer from several starting unitaries in one process: the
+ * original orbitals and nr_starts-1 random rotations of them. The starts run in a
+ * pool of threads and all use the two-body integrals of the first one. They run in
+ * stages of a limited number of orbital steps, after every stage only the
+ * best fraction of the unconverged starts continues.
+ */
+class MultiStart
+{
+   public:
+      MultiStart(const CheMPS2::Hamiltonian &, int nr_starts);
+
+      virtual ~MultiStart();
+
+      int Run();
+
+      double get_energy() const;
+
+      LocalMinimizer& getBest() const;
+
+      void set_threads(int);
+
+      void set_stage_steps(int);
+
+      void set_keep_fraction(double);
+
+   private:
+
+      //! all the starts, the first one are the original orbitals
+      std::vector< std::unique_ptr<LocalMinimizer> > starts;
+
+      //! the energy of every start after its last stage
+      std::vector<double> energies;
+
+      //! the number of threads in the pool
+      int threads;
+
+      //! the maximal number of orbital steps of a start in one stage
+      int stage_steps;
+
+      //! the fraction of the unconverged starts that continues after a stage
+      double keep_fraction;
+
+      //! the start with the lowest energy
+      int best;
+};
+
+}
+
+#endif /* MULTISTART_H */
+
+/*  vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,136 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#ifndef ORBITALOPTIMIZER_H
+#define ORBITALOPTIMIZER_H
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include "Method.h"
+#include "Hamiltonian.h"
+#include "UnitaryMatrix.h"
+#include "OrbitalTransform.h"
+
+namespace doci2DM {
+   class PotentialReduction;
+   class BoundaryPoint;
+}
+
+namespace simanneal {
+
+/**
+ * Optimizes all the orbital rotations at once. The gradient and the diagonal of the hessian
+ * to the rotation angles of all the orbital pairs are calculated from the converged rdm
+ * (see doci2DM::OrbitalScan::gradient). The step is a L-BFGS step, preconditioned with
+ * the diagonal hessian and limited by a trust radius, and is applied as exp(X) to the
+ * unitary. After every step the SDP is solved again.
+ */
+class OrbitalOptimizer
+{
+   public:
+      OrbitalOptimizer(const CheMPS2::Hamiltonian &);
+
+      OrbitalOptimizer(CheMPS2::Hamiltonian &&);
+
+      virtual ~OrbitalOptimizer();
+
+      int Minimize(int start_iters=0);
+
+      double get_energy() const;
+
+      double calc_new_energy();
+
+      simanneal::UnitaryMatrix& get_Optimal_Unitary();
+
+      CheMPS2::Hamiltonian& getHam() const;
+
+      OrbitalTransform& getOrbitalTf() const;
+
+      doci2DM::Method& getMethod() const;
+
+      void UseBoundaryPoint();
+
+      void UsePotentialReduction();
+
+      doci2DM::PotentialReduction& getMethod_PR() const;
+
+      doci2DM::BoundaryPoint& getMethod_BP() const;
+
+      double get_conv_crit() const;
+
+      void set_conv_crit(double);
+
+      void set_max_iters(int);
+
+      void set_history(int);
+
+      void set_trust_radius(double);
+
+   private:
+
+      void init();
+
+      std::vector<double> lbfgs_direction(const std::vector<double> &grad, const std::vector<double> &hess) const;
+
+      //! stop when the largest component of the orbital gradient is smaller than this
+      double conv_crit;
+
+      double energy;
+
+      //! maximum number of SDP solves
+      int max_iters;
+
+      //! number of (s,y) pairs to keep for the L-BFGS update
+      int history;
+
+      //! the maximal norm of a step
+      double trust_radius;
+
+      std::unique_ptr<doci2DM::Method> method;
+
+      //! Holds the current hamiltonian
+      std::unique_ptr<CheMPS2::Hamiltonian> ham;
+
+      //! the actual orbital transform
+      std::unique_ptr<simanneal::OrbitalTransform> orbtrans;
+
+      //! all the orbital pairs (k,l) with k<l in the same irrep
+      std::vector< std::pair<int,int> > pairs;
+
+      //! the index of every pair in the X vector of UnitaryMatrix::updateUnitary
+      std::vector<int> x_index;
+
+      //! the L-BFGS history: steps
+      std::vector< std::vector<double> > s_hist;
+
+      //! the L-BFGS history: change of the gradient
+      std::vector< std::vector<double> > y_hist;
+};
+
+}
+
+#endif /* ORBITALOPTIMIZER_H */
+
+/*  vim: set ts=3 sw=3 expandtab :*/
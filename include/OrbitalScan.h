@@ -0,0 +1,122 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+
+#ifndef ORBITAL_SCAN_H
+#define ORBITAL_SCAN_H
+
+#include <vector>
+#include <tuple>
+#include <utility>
+
+namespace doci2DM
+{
+
+class TPM;
+class DociIntegrals;
+
+/**
+ * Scans the jacobi rotations of many orbital pairs for one rdm and one set of integrals.
+ * The energy after a rotation of (k,l) over theta is a quartic polynomial in cos(theta)
+ * and sin(theta). In the constructor the sums over the orbitals that these coefficients
+ * need are contracted once (O(L^3)). After that, the coefficients of a pair cost O(1),
+ * except for the sin*cos term that needs the k/l slices of the integrals (O(L)).
+ * The rdm and the integrals should outlive this object.
+ */
+class OrbitalScan
+{
+   public:
+
+      //! The coefficients of the energy after a rotation over theta (see energy())
+      struct Coefs
+      {
+         double constant, cos4, sin4, cos2, sin2, sincos, cos2sin2, sin3cos, cos3sin;
+      };
+
+      OrbitalScan(const TPM &, const DociIntegrals &);
+
+      virtual ~OrbitalScan() = default;
+
+      Coefs coefficients(int k, int l) const;
+
+      Coefs coefficients(int k, int l, double *) const;
+
+      double energy(const Coefs &, double theta) const;
+
+      std::pair<double,bool> find_min_angle(const Coefs &, double start_angle) const;
+
+      std::vector< std::tuple<int,int,double,double> > scan(const std::vector< std::pair<int,int> > &pairs, double screening=0) const;
+
+      void gradient(const std::vector< std::pair<int,int> > &pairs, std::vector<double> &grad, std::vector<double> &hess) const;
+
+   private:
+
+      //! the rdm
+      const TPM &rdm;
+
+      //! the integrals
+      const DociIntegrals &ints;
+
+      //! nr of sp orbitals
+      int L;
+
+      //! 2/(N-1)
+      double c;
+
+      //! rdm(a,a+L,b,b+L)
+      std::vector<double> B;
+
+      //! rdm(a,b,a,b)
+      std::vector<double> V2;
+
+      //! 2*V(a,b,a,b)-V(a,b,b,a)
+      std::vector<double> Y;
+
+      //! 2 sum_a V(p,p,a,a) B(q,a) + (Y(p,a)+c T(p,p)) V2(q,a)
+      std::vector<double> F;
+
+      //! sum_a V2(q,a)
+      std::vector<double> rV;
+
+      //! sum_a c T(a,a) V2(a,q)
+      std::vector<double> U;
+
+      //! the row sums of the energy terms S(a,b) of all pairs a,b
+      std::vector<double> rowS;
+
+      //! sum_a c T(a,a) B(a,a)
+      double D;
+
+      //! sum_a,b S(a,b)
+      double Stot;
+
+      inline double f(int p, int q, int a) const;
+
+      inline double S(int a, int b) const;
+};
+
+}
+
+#endif /* ORBITAL_SCAN_H */
+
+/* vim: set ts=3 sw=3 expandtab :*/
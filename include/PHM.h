@@ -25,17 +25,27 @@
 #define PHM_H
 
 #include<memory>
+#include<vector>
 #include<hdf5.h>
 
 #include "helpers.h"
-#include "BlockStructure.h"
+#include "Matrix.h"
+#include "Vector.h"
 
 namespace doci2DM
 {
 
 class TPM;
-
-class PHM: public BlockMatrix
+class Segments;
+
+/**
+ * The DOCI G matrix. It consists of one LxL block and L(L-1)/2 symmetric
+ * 2x2 blocks. The LxL block is a normal Matrix, the 2x2 blocks are stored
+ * as a structure of arrays: for each block i, the block looks like
+ * ( a[i] c[i] ; c[i] d[i] ). All the 2x2 operations are written as simple
+ * loops over these contiguous arrays so the compiler can vectorize them.
+ */
+class PHM
 {
    friend std::ostream &operator<<(std::ostream &output,PHM &phm);
 
@@ -43,43 +53,71 @@ class PHM: public BlockMatrix
 
       PHM(int, int);
 
-      PHM(const PHM &) = default;
+      PHM(const PHM &);
 
       PHM(PHM &&) = default;
 
       virtual ~PHM() = default;
 
-      PHM& operator=(const PHM &) = default;
+      PHM& operator=(const PHM &);
 
       PHM& operator=(PHM &&) = default;
 
-      using BlockMatrix::operator=;
+      PHM& operator=(double);
+
+      PHM& operator+=(const PHM &);
+
+      PHM& operator-=(const PHM &);
+
+      PHM& daxpy(double, const PHM &);
+
+      PHM& operator*=(double);
 
-      using BlockMatrix::operator();
+      PHM& operator/=(double);
 
       double operator()(int a, int b, int c, int d) const;
 
-      const Matrix& getBlock(int a, int b) const;
+      const Matrix& getLxL() const;
 
-      Matrix& getBlock(int a, int b);
+      Matrix& getLxL();
+
+      double get2x2(int a, int b, int i, int j) const;
 
       int gN() const;
 
       int gL() const;
 
+      int gnr() const;
+
+      int gn2x2() const;
+
+      double trace() const;
+
+      double ddot(const PHM &) const;
+
+      void dscal(double);
+
+      void unit();
+
       void G(const TPM &);
 
       Matrix Gimg(const TPM &) const;
 
       Matrix Gbuild() const;
 
-      void sep_pm(BlockMatrix &, BlockMatrix &);
+      void rotate(int, int, double);
+
+      void sep_pm(PHM &, PHM &);
 
       void sqrt(int);
 
       void invert();
 
-      void L_map(const BlockMatrix &, const BlockMatrix &);
+      void L_map(const PHM &, const PHM &);
+
+      void eigenvalues_2x2(Vector &) const;
+
+      void segments(Segments &) const;
 
       void WriteToFile(hid_t &group_id) const;
 
@@ -95,6 +133,21 @@ class PHM: public BlockMatrix
 
       int N;
 
+      //! the LxL block
+      std::unique_ptr<Matrix> block;
+
+      //! number of 2x2 blocks
+      int n2x2;
+
+      //! the upper diagonal elements of the 2x2 blocks
+      std::vector<double> blk_a;
+
+      //! the off diagonal elements of the 2x2 blocks
+      std::vector<double> blk_c;
+
+      //! the lower diagonal elements of the 2x2 blocks
+      std::vector<double> blk_d;
+
       //! table translating single particles indices to two particle indices
       static std::unique_ptr<helpers::tmatrix<int>> s2ph;
 
@@ -112,4 +165,4 @@ class PHM: public BlockMatrix
 
 #endif /* PHM_H */
 
-/*  vim: set ts=3 sw=3 expandtab :*/ 
+/*  vim: set ts=3 sw=3 expandtab :*/
@@ -29,6 +29,7 @@
 #include <string>
 
 #include "include.h"
+#include "LinComb.h"
 
 namespace doci2DM
 {
@@ -63,6 +64,8 @@ class SUP
 
       void dscal(double);
 
+      void unit();
+
       int gN() const;
 
       int gL() const;
@@ -81,6 +84,8 @@ class SUP
 
       void invert();
 
+      void rotate(int, int, double);
+
       void fill(const TPM &);
 
       void sqrt(int);
@@ -101,6 +106,30 @@ class SUP
 
       void ReadFromFile(std::string filename);
 
+      void segments(Segments &) const;
+
+      /**
+       * Assign a linear combination of SUP's in one fused pass
+       * @param expr the linear combination
+       */
+      template<int n>
+      SUP& operator=(const LinComb<SUP,n> &expr)
+      {
+         expr.eval(*this, false);
+         return *this;
+      }
+
+      /**
+       * Add a linear combination of SUP's in one fused pass
+       * @param expr the linear combination
+       */
+      template<int n>
+      SUP& operator+=(const LinComb<SUP,n> &expr)
+      {
+         expr.eval(*this, true);
+         return *this;
+      }
+
    private:
       //! number of particles
       int N;
@@ -118,6 +147,9 @@ class SUP
       std::unique_ptr<PHM> G;
 };
 
+template<>
+struct is_lincomb_type<SUP> : std::true_type {};
+
 }
 
 #endif /* SUP_H */
@@ -25,6 +25,8 @@
 #define SIM_ANNEAL_H
 
 #include <random>
+#include <vector>
+#include <utility>
 
 #include "Method.h"
 #include "Hamiltonian.h"
@@ -34,6 +36,7 @@
 namespace doci2DM {
 class PotentialReduction;
 class BoundaryPoint;
+class OrbitalScan;
 }
 
 namespace simanneal
@@ -50,12 +53,18 @@ class SimulatedAnnealing
 
       bool accept_function(double);
 
+      bool metropolis(double);
+
       void optimize();
 
       void optimize_mpi();
 
+      void optimize_pt(unsigned int rounds=200, unsigned int segment_steps=50);
+
       double calc_new_energy();
 
+      double calc_new_energy(const CheMPS2::Hamiltonian &);
+
       void calc_energy();
 
       double get_energy() const;
@@ -68,6 +77,12 @@ class SimulatedAnnealing
 
       void Set_delta_temp(double);
 
+      void Set_min_temp(double);
+
+      void Set_delayed_acceptance(bool);
+
+      void Set_guided_proposals(bool);
+
       simanneal::UnitaryMatrix& get_Optimal_Unitary();
 
       CheMPS2::Hamiltonian& getHam() const;
@@ -86,6 +101,12 @@ class SimulatedAnnealing
 
    private:
 
+      void rotate(int, int, double);
+
+      void undo();
+
+      void proposal_distribution(const doci2DM::OrbitalScan &, const std::vector< std::pair<int,int> > &, std::vector<double> &, std::vector<double> &) const;
+
       std::unique_ptr<doci2DM::Method> method;
 
       //! Holds the current hamiltonian
@@ -97,12 +118,17 @@ class SimulatedAnnealing
       //! the current unitary
       std::unique_ptr<simanneal::UnitaryMatrix> opt_unitary;
 
+      //! the rotations of the current move, to undo them when the move is rejected
+      std::vector<JacobiRotation> journal;
+
       //! energy of current iteration
       double energy;
       //! the start temperatur
       double start_temp;
       //! the change in temperatur between steps
       double delta_temp;
+      //! the lowest temperature of the parallel tempering ladder
+      double min_temp;
       //! the change in the angle allows in steps
       double delta_angle;
       //! the maximum allows angle
@@ -118,6 +144,18 @@ class SimulatedAnnealing
       //! number of unaccepted steps
       unsigned int unaccepted;
 
+      //! number of steps rejected by the screening, without a SDP solve
+      unsigned int screened;
+
+      //! screen the steps with the estimated energy before solving the SDP
+      bool delayed_acceptance;
+
+      //! draw the moves from the energy landscape of the current 2DM
+      bool guided_proposals;
+
+      //! the fraction of the uniform distribution in the guided proposal of the pairs
+      double guided_mix;
+
       //! bool to indicate if we should quite the optimalisation
       bool stop_running;
 
@@ -31,7 +31,9 @@
 #include <hdf5.h>
 
 #include "Container.h"
+#include "LinComb.h"
 #include "helpers.h"
+#include "DociIntegrals.h"
 
 namespace doci2DM
 {
@@ -60,6 +62,30 @@ class TPM: public Container
 
       using Container::operator=;
 
+      using Container::operator+=;
+
+      /**
+       * Assign a linear combination of TPM's in one fused pass
+       * @param expr the linear combination
+       */
+      template<int n>
+      TPM& operator=(const LinComb<TPM,n> &expr)
+      {
+         expr.eval(*this, false);
+         return *this;
+      }
+
+      /**
+       * Add a linear combination of TPM's in one fused pass
+       * @param expr the linear combination
+       */
+      template<int n>
+      TPM& operator+=(const LinComb<TPM,n> &expr)
+      {
+         expr.eval(*this, true);
+         return *this;
+      }
+
       using Container::operator();
 
       double operator()(int a, int b, int c, int d) const;
@@ -72,7 +98,7 @@ class TPM: public Container
 
       void HF_molecule(std::string filename);
 
-      void ham(std::function<double(int,int)> &T, std::function<double(int,int,int,int)> &V);
+      void ham(const DociIntegrals &);
 
       void WriteToFile(hid_t &group_id) const;
 
@@ -92,6 +118,8 @@ class TPM: public Container
 
       void collaps(const SUP &, const Lineq &);
 
+      void collaps(const SUP &, const Lineq &, TPM &, double *, double *);
+
       void constr_grad(double t,const SUP &, const TPM &, const Lineq &);
 
       void Q(const TPM &);
@@ -110,14 +138,30 @@ class TPM: public Container
 
       void Proj_E(const Lineq &, int option=0);
 
+      void Proj_E(const Lineq &, double *, double *, int option=0);
+
       std::vector<TPM> DOCI_constrains() const;
 
       std::vector<TPM> singlet_constrains() const;
 
       void S(const TPM &);
 
+      void S(const TPM &, PHM &, TPM &);
+
       int InverseS(TPM &, const Lineq &);
 
+      int InverseS(TPM &, const Lineq &, TPM &, TPM &, PHM &, TPM &, double *, double *);
+
+      void InverseS_direct(const TPM &, const Lineq &);
+
+      void InverseS_direct(const TPM &, const Lineq &, double *, double *);
+
+      void get_orbital_part(double *) const;
+
+      void add_orbital_part(double, const double *);
+
+      void get_orbital_dual(double *) const;
+
       double getDiag(int, int) const;
 
       void G(const PHM &);
@@ -132,13 +176,19 @@ class TPM: public Container
 
       std::pair<double,bool> find_min_angle_doci(const TPM &, int, int, double=0) const;
 
-      double calc_rotate(int k, int l, double theta, std::function<double(int,int)> &T, std::function<double(int,int,int,int)> &V) const;
+      double calc_rotate(int k, int l, double theta, const DociIntegrals &) const;
+
+      double calc_rotate(int k, int l, double theta, const DociIntegrals &, double *) const;
 
       double calc_rotate_slow(int k, int l, double theta, std::function<double(int,int)> &T, std::function<double(int,int,int,int)> &V) const;
 
-      std::pair<double,bool> find_min_angle(int k, int l, double start_angle, std::function<double(int,int)> &T, std::function<double(int,int,int,int)> &V) const;
+      std::pair<double,bool> find_min_angle(int k, int l, double start_angle, const DociIntegrals &) const;
+
+      std::pair<double,bool> find_min_angle(int k, int l, double start_angle, const DociIntegrals &, double *) const;
 
-      void rotate(int, int, double, std::function<double(int,int)> &, std::function<double(int,int,int,int)> &);
+      void rotate(int, int, double, const DociIntegrals &);
+
+      void rotate(int, int, double, const DociIntegrals &, double *);
 
       void WriteFullToFile(std::string filename) const;
 
@@ -148,6 +198,10 @@ class TPM: public Container
 
    private:
 
+      void S_Q(const TPM &);
+
+      void S_G(const TPM &, PHM &, TPM &);
+
       void constr_lists(int L);
 
       //! number of particles
@@ -166,6 +220,9 @@ class TPM: public Container
       static std::unique_ptr<helpers::tmatrix<unsigned int>> t2s;
 };
 
+template<>
+struct is_lincomb_type<TPM> : std::true_type {};
+
 }
 
 #endif
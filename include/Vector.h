@@ -136,6 +136,8 @@ class Vector
 
       void sep_pm(Vector &, Vector &);
 
+      void segments(Segments &) const;
+
    private:
 
       //!pointer of doubles, contains the numbers, the vector
@@ -0,0 +1,97 @@
+/* 
+ * @BEGIN LICENSE
+ *
+ * Copyright (C) 2014-2015  Ward Poelmans
+ *
+ * This file is part of v2DM-DOCI.
+ * 
+ * v2DM-DOCI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * v2DM-DOCI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with v2DM-DOCI.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @END LICENSE
+ */
+
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <memory>
+#include <vector>
+
+#include "TPM.h"
+#include "SUP.h"
+#include "PHM.h"
+
+namespace doci2DM
+{
+
+/**
+ * Scratch space for the inner loops of a Method. It is sized once
+ * from (L,N) and hands out pre-shaped TPM, SUP and PHM objects and
+ * arrays for the orbital part of a TPM, so the steady state of an
+ * iteration doesn't hit the allocator. The caller decides which slot
+ * is used for what.
+ */
+class Workspace
+{
+   public:
+
+      Workspace(int L, int N, int n_tpm, int n_sup, int n_phm, int n_orb=0);
+
+      Workspace(const Workspace &);
+
+      Workspace(Workspace &&) = default;
+
+      virtual ~Workspace() = default;
+
+      Workspace& operator=(const Workspace &) = delete;
+
+      Workspace& operator=(Workspace &&) = default;
+
+      TPM& getTPM(int);
+
+      SUP& getSUP(int);
+
+      PHM& getPHM(int);
+
+      double* getOrbital(int);
+
+      int gL() const;
+
+      int gN() const;
+
+      unsigned long gHandedOut() const;
+
+   private:
+
+      int L;
+
+      int N;
+
+      std::vector< std::unique_ptr<TPM> > tpms;
+
+      std::vector< std::unique_ptr<SUP> > sups;
+
+      std::vector< std::unique_ptr<PHM> > phms;
+
+      //! arrays the size of the orbital part of a TPM (2L doubles)
+      std::vector< std::vector<double> > orbs;
+
+      //! number of getTPM/getSUP/getPHM/getOrbital calls
+      unsigned long handed_out;
+};
+
+}
+
+#endif /* WORKSPACE_H */
+
+/* vim: set ts=3 sw=3 expandtab :*/
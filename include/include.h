@@ -74,6 +74,7 @@
 
 #include "SUP.h"
 #include "EIG.h"
+#include "Workspace.h"
 
 #include "Lineq.h"
 
@@ -40,6 +40,7 @@ extern "C" {
    double ddot_(const int *n,double *x,int *incx,double *y,int *incy);
    void dsyev_(char *jobz,char *uplo,int *n,double *A,int *lda,double *W,double *work,int *lwork,int *info);
    void dpotrf_(char *uplo,int *n,double *A,int *lda,int *INFO);
+   void dpotrs_(char *uplo,int *n,int *nrhs,double *A,int *lda,double *B,int *ldb,int *INFO);
    void dpotri_(char *uplo,int *n,double *A,int *lda,int *INFO);
    void dsyevr_( char* jobz, char* range, char* uplo, int* n, double* a, int* lda, double* vl, double* vu, int* il, int* iu, double* abstol, int* m, double* w, double* z, int* ldz, int* isuppz, double* work, int* lwork, int* iwork, int* liwork, int* info );
    void dsyevd_( char* jobz, char* uplo, int* n, double* a, int* lda, double* w, double* work, int* lwork, int* iwork, int* liwork, int* info );